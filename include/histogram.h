@@ -0,0 +1,136 @@
+#ifndef __HISTOGRAM__
+#define __HISTOGRAM__
+
+#include <stdint.h>
+
+#include "topologies.h"
+
+/* Log-bucketed (HDR-style) histogram: values below 2^PRECISION are kept
+ * exactly; above it, each power of two is split into 2^(PRECISION-1)
+ * buckets, so the relative error is below 2^(1-PRECISION) (~1.6%). */
+#define HISTOGRAM_PRECISION 7
+#define HISTOGRAM_HALF (1UL << (HISTOGRAM_PRECISION - 1))
+#define HISTOGRAM_BUCKETS ((64 - HISTOGRAM_PRECISION + 2) * HISTOGRAM_HALF)
+
+#define HISTOGRAM_MAGIC "KNCHIST"
+#define HISTOGRAM_VERSION 1
+
+/* Histogram structure. Written by one thread only, without locks:
+ * counters are updated with relaxed atomics, so another thread may
+ * merge it while it is being recorded. Such a merge is approximate:
+ * values recorded meanwhile may be in the counts but not in sum, min
+ * and max. A merge after the owner is done (e.g. joined) is exact. */
+struct Histogram
+{
+    uint64_t total;
+    uint64_t min, max;
+    uint64_t sum;
+    uint64_t counts[HISTOGRAM_BUCKETS];
+} typedef Histogram;
+
+/* Histograms recorded per routing worker */
+struct RouteHistograms
+{
+    Histogram hops;     // Hop count of each route.
+    Histogram route_ns; // Time to work out each route, in nanoseconds.
+    Histogram latency;  // Simulated packet latency, in cycles (recorded by simulation engines).
+} typedef RouteHistograms;
+
+/**
+ * @brief Define an empty histogram.
+ *
+ * @param h The histogram to be defined.
+ */
+void define_histogram(Histogram *h);
+
+/**
+ * @brief Free the histogram structure.
+ *
+ * @param h A pointer to the histogram to be freed.
+ */
+void free_histogram(Histogram **h);
+
+/**
+ * @brief Record a value. Only the owner thread may record.
+ *
+ * @param h The histogram.
+ * @param value The value to be recorded.
+ */
+void histogram_record(Histogram *h, uint64_t value);
+
+/**
+ * @brief Add the counts of a histogram into another one.
+ *
+ * @param dst The histogram merged into (owned by the calling thread).
+ * @param src The histogram to be merged (if it is being recorded, the result is approximate).
+ */
+void histogram_merge(Histogram *dst, Histogram *src);
+
+/**
+ * @brief Value below which a percentage of the recorded values fall.
+ *
+ * @param h The histogram.
+ * @param percentile The percentage, in [0, 100].
+ * @return uint64_t The highest value of the matching bucket (0 if empty).
+ */
+uint64_t histogram_percentile(Histogram *h, double percentile);
+
+/**
+ * @brief Mean of the recorded values.
+ *
+ * @param h The histogram.
+ * @return double The mean (0 if empty).
+ */
+double histogram_mean(Histogram *h);
+
+/**
+ * @brief Print a summary of the histogram.
+ *
+ *  FORMAT: %name%: n = %total%, mean %mean% %unit%, p50 ..., p99 ..., p99.9 ..., max ...
+ *
+ * @param h The histogram.
+ * @param name The name of the recorded quantity.
+ * @param unit The unit of the values.
+ */
+void print_histogram(Histogram *h, const char *name, const char *unit);
+
+/**
+ * @brief Write the histogram to a binary file, as sparse (bucket, count)
+ * pairs. Files of several runs can be combined with histogram_import.
+ *
+ * @param h The histogram.
+ * @param path The path of the file.
+ */
+void histogram_export(Histogram *h, const char *path);
+
+/**
+ * @brief Merge a histogram file into a histogram.
+ *
+ * @param h The histogram merged into.
+ * @param path The path of the file.
+ */
+void histogram_import(Histogram *h, const char *path);
+
+/**
+ * @brief Define the histograms of a routing worker.
+ *
+ * @param hists The histograms to be defined.
+ */
+void define_route_histograms(RouteHistograms *hists);
+
+/**
+ * @brief Merge the histograms of a routing worker into others.
+ *
+ * @param dst The histograms merged into.
+ * @param src The histograms to be merged.
+ */
+void merge_route_histograms(RouteHistograms *dst, RouteHistograms *src);
+
+/**
+ * @brief Print the non-empty histograms of a routing worker.
+ *
+ * @param hists The histograms.
+ */
+void print_route_histograms(RouteHistograms *hists);
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef __HYPERCUBE__
+#define __HYPERCUBE__
+
+#include <stdint.h>
+
+/* Bit-packed hypercube engine. A node of a n-hypercube is its index:
+ * bit i of the index is coordinate n - 1 - i of the vertex. A node fits
+ * a word (cubes are limited to HYPERCUBE_MAX_DIMS dimensions). */
+
+/**
+ * @brief Routing register of a pair, packed: bit i set iff dimension i
+ * has to be crossed.
+ *
+ * @param u_index The index of the source node.
+ * @param v_index The index of the destination node.
+ * @return uint64_t The packed routing register.
+ */
+static inline uint64_t hypercube_route(uint64_t u_index, uint64_t v_index)
+{
+    return u_index ^ v_index;
+}
+
+/**
+ * @brief Graph distance between two nodes.
+ *
+ * @param u_index The index of the source node.
+ * @param v_index The index of the destination node.
+ * @return unsigned long The number of hops.
+ */
+static inline unsigned long hypercube_distance(uint64_t u_index, uint64_t v_index)
+{
+    return __builtin_popcountll(u_index ^ v_index);
+}
+
+/**
+ * @brief Next dimension to be crossed by e-cube routing (lowest bit first).
+ *
+ * @param u_index The index of the current node.
+ * @param v_index The index of the destination node.
+ * @return long The dimension (bit index), or -1 if already there.
+ */
+static inline long hypercube_next_dim(uint64_t u_index, uint64_t v_index)
+{
+    uint64_t route = u_index ^ v_index;
+
+    return (route == 0) ? -1 : __builtin_ctzll(route);
+}
+
+/**
+ * @brief Next node visited by e-cube routing (lowest bit first).
+ *
+ * @param u_index The index of the current node.
+ * @param v_index The index of the destination node.
+ * @return uint64_t The index of the next node (v_index if already there).
+ */
+static inline uint64_t hypercube_next_hop(uint64_t u_index, uint64_t v_index)
+{
+    uint64_t route = u_index ^ v_index;
+
+    return u_index ^ (route & -route);
+}
+
+/**
+ * @brief Packed routing registers of many pairs.
+ *
+ * @param u Indices of the source nodes.
+ * @param v Indices of the destination nodes.
+ * @param routes Output packed routing registers.
+ * @param n_pairs The number of pairs.
+ */
+void hypercube_route_batch(const uint64_t *u, const uint64_t *v, uint64_t *routes, unsigned long n_pairs);
+
+/**
+ * @brief Graph distances of many pairs.
+ *
+ * @param u Indices of the source nodes.
+ * @param v Indices of the destination nodes.
+ * @param distances Output number of hops of each pair.
+ * @param n_pairs The number of pairs.
+ */
+void hypercube_distance_batch(const uint64_t *u, const uint64_t *v, unsigned char *distances, unsigned long n_pairs);
+
+/**
+ * @brief E-cube next hops of many pairs.
+ *
+ * @param u Indices of the current nodes.
+ * @param v Indices of the destination nodes.
+ * @param next Output indices of the next nodes.
+ * @param n_pairs The number of pairs.
+ */
+void hypercube_next_hop_batch(const uint64_t *u, const uint64_t *v, uint64_t *next, unsigned long n_pairs);
+
+#endif
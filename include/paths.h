@@ -0,0 +1,172 @@
+#ifndef __PATHS__
+#define __PATHS__
+
+#include "topologies.h"
+#include "histogram.h"
+
+/* Minimal Path Iterator structure */
+struct MinimalPathIter
+{
+    k_ary_n_cube *cube;
+    RoutingReg *reg;         // Routing register between source and destination.
+    unsigned long source;    // Index of the source node.
+    unsigned long distance;  // Number of hops of every minimal path.
+    unsigned long *moves;    // Dimension corrected at each hop of the current path.
+                             // The direction of the hop is the sign of reg[dim].
+    unsigned long n_ties;    // Dimensions at k/2 on an even torus: both directions are minimal.
+    unsigned long tie_mask;  // Direction of each tie of the current path (bit set: negative).
+    unsigned long remaining; // Paths left to be visited in the current range.
+    bool started;
+} typedef MinimalPathIter;
+
+/**
+ * @brief Define a lazy iterator over every minimal path between two vertices.
+ * Paths are visited one at a time, using O(distance) memory. On even tori,
+ * a dimension at distance k/2 (a tie) can be crossed in both directions:
+ * paths are visited by choice of directions of the ties, then in
+ * lexicographic order of their moves, and it->reg holds the directions of
+ * the current path. Its buffers come from the thread-local pools, so it
+ * must be freed by the thread that defined it.
+ *
+ * @param it The iterator to be defined.
+ * @param cube A k-ary n-cube.
+ * @param u_index The index of the source node.
+ * @param v_index The index of the destination node.
+ */
+void define_path_iter(MinimalPathIter *it, k_ary_n_cube *cube, unsigned long u_index, unsigned long v_index);
+
+/**
+ * @brief Free the minimal path iterator.
+ *
+ * @param it A pointer to the iterator to be freed.
+ */
+void free_path_iter(MinimalPathIter **it);
+
+/**
+ * @brief Advance the iterator to the next minimal path.
+ *
+ * @param it The iterator.
+ * @return bool 1 if it->moves holds a new path, 0 if the range is exhausted.
+ */
+bool next_minimal_path(MinimalPathIter *it);
+
+/**
+ * @brief Restrict the iterator to the paths of ranks [rank, rank + count).
+ * Used to split the enumeration between parallel consumers.
+ *
+ * @param it The iterator.
+ * @param rank Rank, in visiting order, of the first path to be visited.
+ * @param count Number of paths to be visited.
+ */
+void seek_minimal_path(MinimalPathIter *it, unsigned long rank, unsigned long count);
+
+/**
+ * @brief Draw one minimal path uniformly at random into it->moves.
+ * The iterator is left exhausted afterwards.
+ *
+ * @param it The iterator.
+ * @param seed State of the random generator (must not be 0). Updated.
+ */
+void sample_minimal_path(MinimalPathIter *it, unsigned long *seed);
+
+/**
+ * @brief Number of minimal paths described by a routing register:
+ * the multinomial (sum |r_i|)! / prod(|r_i|!), times 2 for each dimension
+ * that can be crossed in both directions (|r_i| = k/2 on an even torus).
+ *
+ * @param cube The k-ary n-cube the register belongs to.
+ * @param reg A routing register.
+ * @return unsigned long The number of paths (ULONG_MAX if it overflows).
+ */
+unsigned long minimal_path_count(k_ary_n_cube *cube, RoutingReg *reg);
+
+/**
+ * @brief Write the indices of the vertices visited by the current path.
+ *
+ * @param it The iterator.
+ * @param indices Output array, with room for it->distance + 1 indices.
+ */
+void minimal_path_vertices(MinimalPathIter *it, unsigned long *indices);
+
+/**
+ * @brief Print the current path of the iterator.
+ *
+ *  FORMAT: %index% -> %index% -> ...
+ *
+ * @param it The iterator.
+ */
+void print_minimal_path(MinimalPathIter *it);
+
+/**
+ * @brief xorshift64* pseudo-random generator.
+ *
+ * @param seed State of the generator (must not be 0). Updated.
+ * @return unsigned long A pseudo-random number.
+ */
+unsigned long path_rand(unsigned long *seed);
+
+/* Traffic patterns */
+enum TrafficPattern
+{
+    UNIFORM_TRAFFIC,    // Every pair of different nodes.
+    COMPLEMENT_TRAFFIC, // Coordinate c goes to k - 1 - c.
+    TRANSPOSE_TRAFFIC,  // Coordinates are reversed.
+    TORNADO_TRAFFIC     // Coordinate c goes to c + ceil(k/2) - 1 (mod k).
+} typedef TrafficPattern;
+
+/* Path Diversity statistics structure */
+struct PathDiversity
+{
+    unsigned long n_pairs;           // Pairs (source != destination) considered.
+    unsigned long single_path_pairs; // Pairs with only one minimal path.
+    unsigned long min_paths;
+    unsigned long max_paths;         // ULONG_MAX if any count overflows.
+    long double mean_paths;
+    long double mean_log2_paths;
+    long double mean_hops;
+    unsigned long max_hops;
+} typedef PathDiversity;
+
+/**
+ * @brief Destination of a node under a permutation traffic pattern.
+ *
+ * @param cube A k-ary n-cube.
+ * @param pattern A traffic pattern (not UNIFORM_TRAFFIC).
+ * @param u_index The index of the source node.
+ * @return unsigned long The index of the destination node.
+ */
+unsigned long traffic_destination(k_ary_n_cube *cube, TrafficPattern pattern, unsigned long u_index);
+
+/**
+ * @brief Work out the path diversity statistics of a traffic pattern.
+ * The pairs are split between n_threads worker threads. Each thread
+ * records the hop count and route computation time of its pairs in
+ * histograms of its own, merged into hists when it is done. Uniform
+ * traffic is rejected when the number of pairs does not fit in a long
+ * (hypercubes of 32 dimensions or more).
+ *
+ * @param cube A k-ary n-cube.
+ * @param pattern The traffic pattern.
+ * @param n_threads Number of worker threads (<= 0: one per online CPU).
+ * @param stats The statistics to be filled in.
+ * @param hists Histograms the ones of the threads are merged into (may be NULL).
+ */
+void path_diversity(k_ary_n_cube *cube, TrafficPattern pattern, int n_threads, PathDiversity *stats, RouteHistograms *hists);
+
+/**
+ * @brief Print path diversity statistics.
+ *
+ * @param stats The statistics to be printed.
+ */
+void print_path_diversity(PathDiversity *stats);
+
+/**
+ * @brief Print a number of minimal paths, as returned by minimal_path_count.
+ *
+ *  FORMAT: %n_paths%, or "overflow (>= ULONG_MAX)" if it overflowed.
+ *
+ * @param n_paths The number of paths (ULONG_MAX if it overflowed).
+ */
+void print_path_count(unsigned long n_paths);
+
+#endif
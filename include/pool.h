@@ -0,0 +1,127 @@
+#ifndef __POOL__
+#define __POOL__
+
+#include "topologies.h"
+
+/* Memory Pool structure: fixed-size slab allocator */
+struct Pool
+{
+    unsigned long obj_size;    // Size of each object (rounded up to POOL_ALIGN).
+    unsigned long slab_length; // Number of objects per slab.
+    void *slabs;               // Linked list of slabs (first word of each slab).
+    void *free_list;           // Linked list of free objects (first word of each object).
+    unsigned long n_slabs;
+    unsigned long n_in_use;
+} typedef Pool;
+
+#define POOL_ALIGN 16
+#define POOL_SLAB_BYTES 65536
+
+/**
+ * @brief Define a pool of fixed-size objects. A pool is owned by one
+ * thread: it takes no locks.
+ *
+ * @param p The pool to be defined.
+ * @param obj_size The size in bytes of each object.
+ * @param slab_length The number of objects allocated at once (0: fit in POOL_SLAB_BYTES).
+ */
+void define_pool(Pool *p, unsigned long obj_size, unsigned long slab_length);
+
+/**
+ * @brief Free the pool structure, and every slab of it.
+ *
+ * @param p A pointer to the pool to be freed.
+ */
+void free_pool(Pool **p);
+
+/**
+ * @brief Take an object from the pool. Only touches the heap when
+ * every slab is in use.
+ *
+ * @param p The pool.
+ * @return void* An object of p->obj_size bytes (not initialised).
+ */
+void *pool_alloc(Pool *p);
+
+/**
+ * @brief Give an object back to the pool.
+ *
+ * @param p The pool it was taken from.
+ * @param obj The object.
+ */
+void pool_release(Pool *p, void *obj);
+
+/**
+ * @brief Give every object back to the pool at once. The slabs are kept.
+ *
+ * @param p The pool.
+ */
+void pool_release_all(Pool *p);
+
+/**
+ * @brief Thread-local pool for objects of a given size. Pools are
+ * created on first use and freed when the thread exits.
+ *
+ * @param obj_size The size in bytes of each object.
+ * @return Pool* The pool of the calling thread.
+ */
+Pool *thread_pool(unsigned long obj_size);
+
+/**
+ * @brief Free every thread-local pool of the calling thread.
+ * Objects taken from them must not be used afterwards.
+ */
+void free_thread_pools();
+
+/**
+ * @brief Take a vertex with room for n_dims coordinates from the
+ * thread-local pools. Must be released by the same thread.
+ *
+ * @param index The index of the vertex.
+ * @param n_dims The number of dimensions of the coordinates.
+ * @return Vertex* The vertex (coordinates not initialised).
+ */
+Vertex *pooled_vertex(unsigned long index, unsigned long n_dims);
+
+/**
+ * @brief Give a pooled vertex back to the thread-local pools.
+ *
+ * @param v The vertex.
+ */
+void release_vertex(Vertex *v);
+
+/**
+ * @brief Take a routing register from the thread-local pools.
+ * Must be released by the same thread.
+ *
+ * @param length The length of the register.
+ * @return RoutingReg* The register (set to 0).
+ */
+RoutingReg *pooled_routing_reg(unsigned long length);
+
+/**
+ * @brief Give a pooled routing register back to the thread-local pools.
+ *
+ * @param reg The register.
+ */
+void release_routing_reg(RoutingReg *reg);
+
+/**
+ * @brief Take a path buffer (an array of indices) from the thread-local
+ * pools. Lengths are rounded up to a power of two, so paths of
+ * similar length share a pool. Must be released by the same thread.
+ *
+ * @param length The number of entries.
+ * @return unsigned long* The buffer (not initialised).
+ */
+unsigned long *pooled_path_buffer(unsigned long length);
+
+/**
+ * @brief Give a pooled path buffer back to the thread-local pools.
+ *
+ * @param buffer The buffer.
+ * @param length The number of entries it was taken with.
+ */
+void release_path_buffer(unsigned long *buffer, unsigned long length);
+
+#endif
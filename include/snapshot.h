@@ -0,0 +1,81 @@
+#ifndef __SNAPSHOT__
+#define __SNAPSHOT__
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "topologies.h"
+
+#define SNAPSHOT_MAGIC "KNCSNAP"
+#define SNAPSHOT_VERSION 1
+
+/* Snapshot file header. The file is flat and pointer-free:
+ * [ header | coordinates (n_vertex * n int64) | register (n int64) | user state ]
+ * Hypercubes have no coordinate table, so their coordinates section is empty.
+ * All values are in the byte order of the machine that wrote it. */
+struct SnapshotHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    int64_t n, k;
+    uint64_t has_rings;
+    uint64_t n_vertex;
+    uint64_t coords_offset;
+    uint64_t reg_offset;
+    uint64_t user_offset;
+    uint64_t user_size;
+    uint64_t file_size;
+    uint64_t checksum; // FNV-1a of everything after the header.
+} typedef SnapshotHeader;
+
+/**
+ * @brief Write a snapshot of the cube, plus an opaque block of caller
+ * state (RNG seeds, statistics...), into a file. The file is written
+ * aside and renamed, so an old snapshot is never left half-written.
+ *
+ * @param cube The k-ary n-cube.
+ * @param user Caller state to be saved along (may be NULL if user_size is 0).
+ * @param user_size The size in bytes of the caller state.
+ * @param path The path of the snapshot file.
+ */
+void save_snapshot(k_ary_n_cube *cube, const void *user, unsigned long user_size, const char *path);
+
+/**
+ * @brief Write a snapshot in the background. A child process is forked:
+ * it sees a copy-on-write image of the memory at the time of the call,
+ * so the caller can go on modifying the cube and its state right away.
+ * Several writers may run at once: each one writes its own temporary
+ * file, and the snapshot renamed last is the one kept.
+ *
+ * @param cube The k-ary n-cube.
+ * @param user Caller state to be saved along.
+ * @param user_size The size in bytes of the caller state.
+ * @param path The path of the snapshot file.
+ * @return pid_t The writer process, to be passed to wait_snapshot.
+ */
+pid_t save_snapshot_async(k_ary_n_cube *cube, const void *user, unsigned long user_size, const char *path);
+
+/**
+ * @brief Wait for a background snapshot to be written.
+ *
+ * @param writer The writer process returned by save_snapshot_async.
+ * @return bool 1 if the snapshot was written, 0 otherwise.
+ */
+bool wait_snapshot(pid_t writer);
+
+/**
+ * @brief Restore a cube and the caller state from a snapshot file.
+ * The file is mapped into memory and checked before anything is copied:
+ * if it is missing, corrupted or does not match, the cube and the caller
+ * state are left untouched, so the caller can fall back to an older one.
+ *
+ * @param cube The k-ary n-cube to be defined (not defined yet).
+ * @param user Where the caller state is restored (may be NULL if user_size is 0).
+ * @param user_size The size in bytes of the caller state; must match the file.
+ * @param path The path of the snapshot file.
+ * @return bool 1 if the snapshot was restored, 0 otherwise (the reason is printed).
+ */
+bool load_snapshot(k_ary_n_cube *cube, void *user, unsigned long user_size, const char *path);
+
+#endif
@@ -29,14 +29,18 @@ void define_routing_reg(RoutingReg *reg, unsigned long length);
  */
 void free_routing_reg(RoutingReg **reg);
 
+/* Hypercube node indices are read as long */
+#define HYPERCUBE_MAX_DIMS 62
+
 /* K-ary N-cube structure */
 struct k_ary_n_cube
 {
-    PartialGraph *g;
+    PartialGraph *g; // Coordinate table (NULL for hypercubes: a node is its index).
     bool has_rings;
     long n, k;
+    long n_vertex;
     RoutingReg *last_reg;
-    void (*routing_function)(struct k_ary_n_cube *, int, int); // The routing function
+    void (*routing_function)(struct k_ary_n_cube *, long, long); // The routing function
 } typedef k_ary_n_cube;
 
 /**
@@ -48,6 +52,43 @@ struct k_ary_n_cube
  */
 void define_kary_ncube(k_ary_n_cube *cube);
 
+/**
+ * @brief Whether a k-ary n-cube is a hypercube (k == 2 and no rings).
+ *
+ * @param cube A k-ary n-cube, with k and has_rings defined.
+ * @return bool 1 if it is a hypercube.
+ */
+bool is_hypercube(k_ary_n_cube *cube);
+
+/**
+ * @brief Coordinate of a vertex in one dimension. Hypercubes have no
+ * coordinate table: the coordinate is read from the bits of the index.
+ *
+ * @param cube A k-ary n-cube.
+ * @param index The index of the vertex.
+ * @param dim The dimension (0 is the most significant digit of the index).
+ * @return long The coordinate.
+ */
+long vertex_coordinate(k_ary_n_cube *cube, unsigned long index, unsigned long dim);
+
+/**
+ * @brief Print the index and coordinates of a vertex of the cube.
+ *
+ *  FORMAT: %index% [ coord., sep. by spaces ]
+ *
+ * @param cube A k-ary n-cube.
+ * @param index The index of the vertex.
+ */
+void print_cube_vertex(k_ary_n_cube *cube, unsigned long index);
+
+/**
+ * @brief Set the routing function of a k-ary n-cube from its features.
+ *
+ * @param cube A k-ary n-cube, with n, k and has_rings defined.
+ * @return const char* The name of the topology.
+ */
+const char *select_routing_function(k_ary_n_cube *cube);
+
 /**
  * @brief Free the k-ary n-cube structure.
  *
@@ -62,7 +103,19 @@ void free_kary_ncube(k_ary_n_cube **cube);
  * @param u_index The index of the source node.
  * @param v_index The index of the destination node.
  */
-void routing_from(k_ary_n_cube *cube, int u_index, int v_index);
+void routing_from(k_ary_n_cube *cube, long u_index, long v_index);
+
+/**
+ * @brief Work out the routing register from one vertex to another,
+ * without touching the last register of the cube. Safe to be called
+ * from several threads at once, each one with its own register.
+ *
+ * @param cube A k-ary n-cube.
+ * @param u_index The index of the source node.
+ * @param v_index The index of the destination node.
+ * @param reg The register to be filled in (length n).
+ */
+void routing_reg_from(k_ary_n_cube *cube, unsigned long u_index, unsigned long v_index, RoutingReg *reg);
 
 /**
  * @brief Routing function for n-dimensional mesh, with k-nodes per dim.
@@ -71,7 +124,7 @@ void routing_from(k_ary_n_cube *cube, int u_index, int v_index);
  * @param u A vertex in the cube
  * @param v Another vertex in the cube
  */
-void mesh_routing_func(k_ary_n_cube *cube, int u_index, int v_index);
+void mesh_routing_func(k_ary_n_cube *cube, long u_index, long v_index);
 
 /**
  * @brief Routing function for n-dimensional torus, with k-nodes per dim.
@@ -80,7 +133,7 @@ void mesh_routing_func(k_ary_n_cube *cube, int u_index, int v_index);
  * @param u A vertex in the cube
  * @param v Another vertex in the cube
  */
-void torus_routing_func(k_ary_n_cube *cube, int u_index, int v_index);
+void torus_routing_func(k_ary_n_cube *cube, long u_index, long v_index);
 
 /**
  * @brief Routing function for n-dimensional hypercube.
@@ -89,7 +142,7 @@ void torus_routing_func(k_ary_n_cube *cube, int u_index, int v_index);
  * @param u A vertex in the cube
  * @param v Another vertex in the cube
  */
-void hypercube_routing_func(k_ary_n_cube *cube, int u_index, int v_index);
+void hypercube_routing_func(k_ary_n_cube *cube, long u_index, long v_index);
 
 /**
  * @brief Define a k-ary n-cube vertex coordinates.
@@ -3,6 +3,7 @@
 #include <errno.h>
 
 #include "include/topologies.h"
+#include "include/pool.h"
 
 extern int errno;
 
@@ -41,6 +42,7 @@ int main()
 
     // Free the k-ary n-cube
     free_kary_ncube(&cube);
+    free_thread_pools();
 
     return 0;
 }
\ No newline at end of file
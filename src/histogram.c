@@ -0,0 +1,350 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+extern int errno;
+
+#include "../include/histogram.h"
+
+/* Header of a histogram file, followed by n_pairs (bucket, count) pairs */
+struct HistogramFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t precision;
+    uint64_t total, min, max, sum;
+    uint64_t n_pairs;
+} typedef HistogramFileHeader;
+
+/* Relaxed atomic accesses: the owner is the only writer */
+#define LOAD(x) __atomic_load_n(&(x), __ATOMIC_RELAXED)
+#define STORE(x, v) __atomic_store_n(&(x), (v), __ATOMIC_RELAXED)
+
+/**
+ * @brief Bucket of a value.
+ *
+ * @param value The value.
+ * @return unsigned long The index of the bucket.
+ */
+static unsigned long bucket_of(uint64_t value)
+{
+    unsigned long msb, shift;
+
+    if (value < (1UL << HISTOGRAM_PRECISION))
+        return value;
+
+    // Keep the PRECISION most significant bits of the value.
+    msb = 63 - __builtin_clzl(value);
+    shift = msb - HISTOGRAM_PRECISION + 1;
+    return shift * HISTOGRAM_HALF + (value >> shift);
+}
+
+/**
+ * @brief Highest value that falls into a bucket.
+ *
+ * @param bucket The index of the bucket.
+ * @return uint64_t The highest value.
+ */
+static uint64_t bucket_highest(unsigned long bucket)
+{
+    unsigned long shift;
+
+    if (bucket < (1UL << HISTOGRAM_PRECISION))
+        return bucket;
+
+    shift = bucket / HISTOGRAM_HALF - 1;
+    return (((uint64_t)(bucket - shift * HISTOGRAM_HALF) + 1) << shift) - 1;
+}
+
+/*! HISTOGRAM STRUCTURE -- INIT !*/
+
+/**
+ * @brief Define an empty histogram.
+ *
+ * @param h The histogram to be defined.
+ */
+void define_histogram(Histogram *h)
+{
+    memset(h, 0, sizeof(Histogram));
+    h->min = UINT64_MAX;
+}
+
+/**
+ * @brief Free the histogram structure.
+ *
+ * @param h A pointer to the histogram to be freed.
+ */
+void free_histogram(Histogram **h)
+{
+    free(*h);
+}
+
+/**
+ * @brief Record a value.
+ *
+ * @param h The histogram.
+ * @param value The value to be recorded.
+ */
+void histogram_record(Histogram *h, uint64_t value)
+{
+    unsigned long bucket = bucket_of(value);
+
+    STORE(h->counts[bucket], LOAD(h->counts[bucket]) + 1);
+    if (value < LOAD(h->min))
+        STORE(h->min, value);
+    if (value > LOAD(h->max))
+        STORE(h->max, value);
+    // Release: a merge that sees this sum also sees the count, min and max.
+    __atomic_store_n(&h->sum, LOAD(h->sum) + value, __ATOMIC_RELEASE);
+    STORE(h->total, LOAD(h->total) + 1);
+}
+
+/**
+ * @brief Add the counts of a histogram into another one.
+ *
+ * @param dst The histogram merged into.
+ * @param src The histogram to be merged.
+ */
+void histogram_merge(Histogram *dst, Histogram *src)
+{
+    uint64_t count, total = 0;
+    uint64_t sum, min, max;
+
+    // Read sum, min and max before the counts: every value they include
+    // is then in the counts too (values recorded meanwhile may be counted
+    // without being in sum, which is why a live merge is approximate).
+    sum = __atomic_load_n(&src->sum, __ATOMIC_ACQUIRE);
+    min = LOAD(src->min);
+    max = LOAD(src->max);
+
+    for (unsigned long bucket = 0; bucket < HISTOGRAM_BUCKETS; bucket++)
+    {
+        count = LOAD(src->counts[bucket]);
+        if (count == 0)
+            continue;
+        STORE(dst->counts[bucket], LOAD(dst->counts[bucket]) + count);
+        total += count;
+    }
+
+    // Take the total from the counts, so it matches them even if src
+    // was being recorded meanwhile.
+    STORE(dst->total, LOAD(dst->total) + total);
+    STORE(dst->sum, LOAD(dst->sum) + sum);
+    if (min < LOAD(dst->min))
+        STORE(dst->min, min);
+    if (max > LOAD(dst->max))
+        STORE(dst->max, max);
+}
+
+/**
+ * @brief Value below which a percentage of the recorded values fall.
+ *
+ * @param h The histogram.
+ * @param percentile The percentage, in [0, 100].
+ * @return uint64_t The highest value of the matching bucket (0 if empty).
+ */
+uint64_t histogram_percentile(Histogram *h, double percentile)
+{
+    uint64_t rank, seen = 0, total = LOAD(h->total), highest;
+
+    if (total == 0)
+        return 0;
+
+    // Rank (1-based) of the value asked for.
+    rank = (uint64_t)(percentile / 100.0 * total + 0.5);
+    rank = (rank < 1) ? 1 : ((rank > total) ? total : rank);
+
+    for (unsigned long bucket = 0; bucket < HISTOGRAM_BUCKETS; bucket++)
+    {
+        seen += LOAD(h->counts[bucket]);
+        if (seen >= rank)
+        {
+            highest = bucket_highest(bucket);
+            return (highest < LOAD(h->max)) ? highest : LOAD(h->max);
+        }
+    }
+
+    return LOAD(h->max);
+}
+
+/**
+ * @brief Mean of the recorded values.
+ *
+ * @param h The histogram.
+ * @return double The mean (0 if empty).
+ */
+double histogram_mean(Histogram *h)
+{
+    uint64_t total = LOAD(h->total);
+
+    return (total > 0) ? (double)LOAD(h->sum) / total : 0;
+}
+
+/**
+ * @brief Print a summary of the histogram.
+ *
+ * @param h The histogram.
+ * @param name The name of the recorded quantity.
+ * @param unit The unit of the values.
+ */
+void print_histogram(Histogram *h, const char *name, const char *unit)
+{
+    printf(" \t %s: n = %ld, mean %.2f %s, p50 %ld, p99 %ld, p99.9 %ld, max %ld\n",
+           name, (unsigned long)LOAD(h->total), histogram_mean(h), unit,
+           (unsigned long)histogram_percentile(h, 50),
+           (unsigned long)histogram_percentile(h, 99),
+           (unsigned long)histogram_percentile(h, 99.9),
+           (unsigned long)LOAD(h->max));
+}
+
+/**
+ * @brief Write the histogram to a binary file.
+ *
+ * @param h The histogram.
+ * @param path The path of the file.
+ */
+void histogram_export(Histogram *h, const char *path)
+{
+    HistogramFileHeader header;
+    uint64_t pair[2];
+    unsigned long bucket;
+    bool written;
+    FILE *file;
+
+    memset(&header, 0, sizeof(HistogramFileHeader));
+    memcpy(header.magic, HISTOGRAM_MAGIC, sizeof(HISTOGRAM_MAGIC));
+    header.version = HISTOGRAM_VERSION;
+    header.precision = HISTOGRAM_PRECISION;
+    header.min = LOAD(h->min);
+    header.max = LOAD(h->max);
+    header.sum = LOAD(h->sum);
+    for (bucket = 0; bucket < HISTOGRAM_BUCKETS; bucket++)
+    {
+        header.total += LOAD(h->counts[bucket]);
+        header.n_pairs += (LOAD(h->counts[bucket]) > 0);
+    }
+
+    file = fopen(path, "wb");
+    if (file == NULL)
+    {
+        fprintf(stderr, "Could not open histogram file %s.\n", path);
+        exit(errno);
+    }
+
+    // A short write (e.g. a full disk) must not pass for a valid file.
+    written = (fwrite(&header, sizeof(HistogramFileHeader), 1, file) == 1);
+    for (bucket = 0; written && (bucket < HISTOGRAM_BUCKETS); bucket++)
+    {
+        pair[0] = bucket;
+        pair[1] = LOAD(h->counts[bucket]);
+        if (pair[1] > 0)
+            written = (fwrite(pair, sizeof(pair), 1, file) == 1);
+    }
+
+    if ((fclose(file) != 0) || !written)
+    {
+        fprintf(stderr, "Could not write histogram file %s.\n", path);
+        exit((errno != 0) ? errno : EIO);
+    }
+}
+
+/**
+ * @brief Merge a histogram file into a histogram.
+ *
+ * @param h The histogram merged into.
+ * @param path The path of the file.
+ */
+void histogram_import(Histogram *h, const char *path)
+{
+    HistogramFileHeader header;
+    Histogram *read;
+    uint64_t pair[2];
+    FILE *file;
+
+    file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        fprintf(stderr, "Could not open histogram file %s.\n", path);
+        exit(errno);
+    }
+
+    if ((fread(&header, sizeof(HistogramFileHeader), 1, file) != 1) ||
+        (memcmp(header.magic, HISTOGRAM_MAGIC, sizeof(HISTOGRAM_MAGIC)) != 0) ||
+        (header.version != HISTOGRAM_VERSION) ||
+        (header.precision != HISTOGRAM_PRECISION))
+    {
+        fprintf(stderr, "%s is not a valid histogram file.\n", path);
+        exit(errno);
+    }
+
+    // Read into a histogram of its own, so a bad file leaves h untouched.
+    read = (Histogram *)malloc(sizeof(Histogram));
+    define_histogram(read);
+    read->min = header.min;
+    read->max = header.max;
+    read->sum = header.sum;
+    for (uint64_t index = 0; index < header.n_pairs; index++)
+    {
+        if ((fread(pair, sizeof(pair), 1, file) != 1) || (pair[0] >= HISTOGRAM_BUCKETS))
+        {
+            fprintf(stderr, "Histogram file %s is corrupted.\n", path);
+            exit(errno);
+        }
+        read->counts[pair[0]] += pair[1];
+        read->total += pair[1];
+    }
+    fclose(file);
+
+    if (read->total != header.total)
+    {
+        fprintf(stderr, "Histogram file %s is corrupted.\n", path);
+        exit(errno);
+    }
+
+    histogram_merge(h, read);
+    free_histogram(&read);
+}
+
+/*! ROUTE HISTOGRAMS -- INIT !*/
+
+/**
+ * @brief Define the histograms of a routing worker.
+ *
+ * @param hists The histograms to be defined.
+ */
+void define_route_histograms(RouteHistograms *hists)
+{
+    define_histogram(&hists->hops);
+    define_histogram(&hists->route_ns);
+    define_histogram(&hists->latency);
+}
+
+/**
+ * @brief Merge the histograms of a routing worker into others.
+ *
+ * @param dst The histograms merged into.
+ * @param src The histograms to be merged.
+ */
+void merge_route_histograms(RouteHistograms *dst, RouteHistograms *src)
+{
+    histogram_merge(&dst->hops, &src->hops);
+    histogram_merge(&dst->route_ns, &src->route_ns);
+    histogram_merge(&dst->latency, &src->latency);
+}
+
+/**
+ * @brief Print the non-empty histograms of a routing worker.
+ *
+ * @param hists The histograms.
+ */
+void print_route_histograms(RouteHistograms *hists)
+{
+    printf(" ** Route Histograms ** \n");
+    if (LOAD(hists->hops.total) > 0)
+        print_histogram(&hists->hops, "Hops", "hops");
+    if (LOAD(hists->route_ns.total) > 0)
+        print_histogram(&hists->route_ns, "Route computation", "ns");
+    if (LOAD(hists->latency.total) > 0)
+        print_histogram(&hists->latency, "Packet latency", "cycles");
+}
@@ -0,0 +1,51 @@
+#include "../include/hypercube.h"
+
+/*! BATCH ROUTING -- INIT !*/
+
+/**
+ * @brief Packed routing registers of many pairs.
+ *
+ * @param u Indices of the source nodes.
+ * @param v Indices of the destination nodes.
+ * @param routes Output packed routing registers.
+ * @param n_pairs The number of pairs.
+ */
+void hypercube_route_batch(const uint64_t *u, const uint64_t *v, uint64_t *routes, unsigned long n_pairs)
+{
+    // Branch-free loops: left for the compiler to vectorise.
+    for (unsigned long pair = 0; pair < n_pairs; pair++)
+        routes[pair] = u[pair] ^ v[pair];
+}
+
+/**
+ * @brief Graph distances of many pairs.
+ *
+ * @param u Indices of the source nodes.
+ * @param v Indices of the destination nodes.
+ * @param distances Output number of hops of each pair.
+ * @param n_pairs The number of pairs.
+ */
+void hypercube_distance_batch(const uint64_t *u, const uint64_t *v, unsigned char *distances, unsigned long n_pairs)
+{
+    for (unsigned long pair = 0; pair < n_pairs; pair++)
+        distances[pair] = __builtin_popcountll(u[pair] ^ v[pair]);
+}
+
+/**
+ * @brief E-cube next hops of many pairs.
+ *
+ * @param u Indices of the current nodes.
+ * @param v Indices of the destination nodes.
+ * @param next Output indices of the next nodes.
+ * @param n_pairs The number of pairs.
+ */
+void hypercube_next_hop_batch(const uint64_t *u, const uint64_t *v, uint64_t *next, unsigned long n_pairs)
+{
+    uint64_t route;
+
+    for (unsigned long pair = 0; pair < n_pairs; pair++)
+    {
+        route = u[pair] ^ v[pair];
+        next[pair] = u[pair] ^ (route & -route);
+    }
+}
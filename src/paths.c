@@ -0,0 +1,655 @@
+#include <math.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+
+extern int errno;
+
+#include "../include/paths.h"
+#include "../include/pool.h"
+#include "../include/histogram.h"
+
+/*! MINIMAL PATH ITERATOR -- INIT !*/
+
+/**
+ * @brief Whether a dimension can be crossed minimally in both directions:
+ * |r| = k/2 on a torus with even k. With k == 2 both directions lead to
+ * the same neighbour, so it is not a tie.
+ *
+ * @param cube A k-ary n-cube.
+ * @param reg_val The value of the register in that dimension.
+ * @return bool 1 if both directions are minimal.
+ */
+static bool is_tie(k_ary_n_cube *cube, long reg_val)
+{
+    return cube->has_rings && (cube->k > 2) && (cube->k % 2 == 0) && (labs(reg_val) == cube->k / 2);
+}
+
+/**
+ * @brief Number of tie dimensions of a register.
+ *
+ * @param cube A k-ary n-cube.
+ * @param reg A routing register.
+ * @return unsigned long The number of ties.
+ */
+static unsigned long count_ties(k_ary_n_cube *cube, RoutingReg *reg)
+{
+    unsigned long dim, n_ties = 0;
+
+    for (dim = 0; dim < reg->length; dim++)
+        n_ties += is_tie(cube, reg->register_[dim]);
+    return n_ties;
+}
+
+/**
+ * @brief Last tie mask of an iterator: every tie in the negative direction.
+ *
+ * @param n_ties The number of ties.
+ * @return unsigned long The mask.
+ */
+static unsigned long last_tie_mask(unsigned long n_ties)
+{
+    return (n_ties >= 64) ? ULONG_MAX : (1UL << n_ties) - 1;
+}
+
+/**
+ * @brief Number of arrangements of the moves of a register:
+ * the multinomial (sum |r_i|)! / prod(|r_i|!).
+ *
+ * @param reg A routing register.
+ * @return unsigned long The number of arrangements (ULONG_MAX if it overflows).
+ */
+static unsigned long multinomial_count(RoutingReg *reg)
+{
+    unsigned long dim, step, n_moves = 0;
+    unsigned __int128 n_paths = 1;
+
+    // Multiply binomials in: after each step, n_paths = prev * C(n_moves, step).
+    for (dim = 0; dim < reg->length; dim++)
+    {
+        for (step = 1; step <= labs(reg->register_[dim]); step++)
+        {
+            n_moves++;
+            n_paths = n_paths * n_moves / step;
+            if (n_paths >= ULONG_MAX)
+                return ULONG_MAX;
+        }
+    }
+
+    return n_paths;
+}
+
+/**
+ * @brief Set the direction of every tie dimension of the register from
+ * the tie mask of the iterator.
+ *
+ * @param it The iterator.
+ */
+static void apply_tie_mask(MinimalPathIter *it)
+{
+    unsigned long dim, tie = 0;
+    long half = it->cube->k / 2;
+
+    for (dim = 0; dim < it->reg->length; dim++)
+    {
+        if (!is_tie(it->cube, it->reg->register_[dim]))
+            continue;
+
+        it->reg->register_[dim] = ((tie < 64) && ((it->tie_mask >> tie) & 1)) ? -half : half;
+        tie++;
+    }
+}
+
+/**
+ * @brief Fill the moves of the iterator with the first path in
+ * lexicographic order: dimensions sorted in ascending order.
+ *
+ * @param it The iterator.
+ */
+static void first_minimal_path(MinimalPathIter *it)
+{
+    unsigned long dim, step, pos = 0;
+
+    for (dim = 0; dim < it->reg->length; dim++)
+    {
+        for (step = 0; step < labs(it->reg->register_[dim]); step++)
+        {
+            it->moves[pos++] = dim;
+        }
+    }
+}
+
+/**
+ * @brief Define a lazy iterator over every minimal path between two vertices.
+ *
+ * @param it The iterator to be defined.
+ * @param cube A k-ary n-cube.
+ * @param u_index The index of the source node.
+ * @param v_index The index of the destination node.
+ */
+void define_path_iter(MinimalPathIter *it, k_ary_n_cube *cube, unsigned long u_index, unsigned long v_index)
+{
+    unsigned long dim;
+
+    it->cube = cube;
+    it->source = u_index;
+
+    // Work out the register of the pair (checks the indices too).
+    it->reg = pooled_routing_reg(cube->n);
+    routing_reg_from(cube, u_index, v_index, it->reg);
+
+    // Start with every tie in the positive direction.
+    it->n_ties = count_ties(cube, it->reg);
+    it->tie_mask = 0;
+    apply_tie_mask(it);
+
+    it->distance = 0;
+    for (dim = 0; dim < it->reg->length; dim++)
+    {
+        it->distance += labs(it->reg->register_[dim]);
+    }
+
+    // Allocate at least one move, so u == v is not a special case.
+    it->moves = pooled_path_buffer(it->distance + 1);
+    first_minimal_path(it);
+
+    it->remaining = minimal_path_count(cube, it->reg);
+    it->started = 0;
+}
+
+/**
+ * @brief Free the minimal path iterator.
+ *
+ * @param it A pointer to the iterator to be freed.
+ */
+void free_path_iter(MinimalPathIter **it)
+{
+    release_path_buffer((*it)->moves, (*it)->distance + 1);
+    release_routing_reg((*it)->reg);
+    free(*it);
+}
+
+/**
+ * @brief Rearrange the moves into the next path in lexicographic order.
+ *
+ * @param moves The moves of the current path.
+ * @param length The number of moves.
+ * @return bool 0 if the moves were already the last path.
+ */
+static bool next_permutation(unsigned long *moves, unsigned long length)
+{
+    unsigned long i, j, tmp;
+
+    if (length < 2)
+        return 0;
+
+    // Find the rightmost ascent moves[i] < moves[i + 1].
+    i = length - 1;
+    while ((i > 0) && (moves[i - 1] >= moves[i]))
+        i--;
+    if (i == 0)
+        return 0;
+    i--;
+
+    // Swap it with the rightmost element bigger than it.
+    j = length - 1;
+    while (moves[j] <= moves[i])
+        j--;
+    tmp = moves[i];
+    moves[i] = moves[j];
+    moves[j] = tmp;
+
+    // Reverse the (descending) suffix.
+    for (i++, j = length - 1; i < j; i++, j--)
+    {
+        tmp = moves[i];
+        moves[i] = moves[j];
+        moves[j] = tmp;
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Advance the iterator to the next minimal path.
+ *
+ * @param it The iterator.
+ * @return bool 1 if it->moves holds a new path, 0 if the range is exhausted.
+ */
+bool next_minimal_path(MinimalPathIter *it)
+{
+    if (it->remaining == 0)
+        return 0;
+
+    if (it->started && !next_permutation(it->moves, it->distance))
+    {
+        // Every arrangement visited for these directions: take the next ones.
+        if (it->tie_mask == last_tie_mask(it->n_ties))
+        {
+            it->remaining = 0;
+            return 0;
+        }
+        it->tie_mask++;
+        apply_tie_mask(it);
+        first_minimal_path(it);
+    }
+
+    it->started = 1;
+    it->remaining--;
+    return 1;
+}
+
+/**
+ * @brief Restrict the iterator to the paths of ranks [rank, rank + count).
+ *
+ * @param it The iterator.
+ * @param rank Rank of the first path to be visited.
+ * @param count Number of paths to be visited.
+ */
+void seek_minimal_path(MinimalPathIter *it, unsigned long rank, unsigned long count)
+{
+    unsigned long dim, pos, left, n_dims = it->reg->length;
+    unsigned long *counts;
+    unsigned __int128 n_paths, sub_paths = 0;
+
+    if (minimal_path_count(it->cube, it->reg) == ULONG_MAX)
+    {
+        fprintf(stderr, "Too many minimal paths to be ranked.\n");
+        exit(errno);
+    }
+
+    if (rank >= minimal_path_count(it->cube, it->reg))
+    {
+        it->remaining = 0;
+        it->started = 1;
+        return;
+    }
+
+    // Rank = tie mask * arrangements per mask + rank of the arrangement.
+    n_paths = multinomial_count(it->reg);
+    it->tie_mask = rank / n_paths;
+    rank %= n_paths;
+    apply_tie_mask(it);
+
+    counts = pooled_path_buffer(n_dims);
+    for (dim = 0; dim < n_dims; dim++)
+    {
+        counts[dim] = labs(it->reg->register_[dim]);
+    }
+
+    // Unrank: at each position, skip the blocks of paths that start
+    // with a smaller dimension. Block size = n_paths * counts[dim] / left.
+    left = it->distance;
+    for (pos = 0; pos < it->distance; pos++, left--)
+    {
+        for (dim = 0; dim < n_dims; dim++)
+        {
+            if (counts[dim] == 0)
+                continue;
+
+            sub_paths = n_paths * counts[dim] / left;
+            if (rank < sub_paths)
+                break;
+            rank -= sub_paths;
+        }
+
+        it->moves[pos] = dim;
+        counts[dim]--;
+        n_paths = sub_paths;
+    }
+    release_path_buffer(counts, n_dims);
+
+    it->remaining = count;
+    it->started = 0;
+}
+
+/**
+ * @brief Draw one minimal path uniformly at random into it->moves.
+ *
+ * @param it The iterator.
+ * @param seed State of the random generator (must not be 0). Updated.
+ */
+void sample_minimal_path(MinimalPathIter *it, unsigned long *seed)
+{
+    unsigned long i, j, tmp;
+
+    // Every choice of directions has as many arrangements: draw one uniformly.
+    if (it->n_ties > 0)
+    {
+        it->tie_mask = path_rand(seed) & last_tie_mask(it->n_ties);
+        apply_tie_mask(it);
+    }
+
+    // A uniform shuffle of the multiset of moves yields every distinct
+    // arrangement with the same probability.
+    first_minimal_path(it);
+    for (i = it->distance; i > 1; i--)
+    {
+        j = ((unsigned __int128)path_rand(seed) * i) >> 64;
+        tmp = it->moves[i - 1];
+        it->moves[i - 1] = it->moves[j];
+        it->moves[j] = tmp;
+    }
+
+    it->remaining = 0;
+    it->started = 1;
+}
+
+/**
+ * @brief Number of minimal paths described by a routing register.
+ *
+ * @param cube The k-ary n-cube the register belongs to.
+ * @param reg A routing register.
+ * @return unsigned long The number of paths (ULONG_MAX if it overflows).
+ */
+unsigned long minimal_path_count(k_ary_n_cube *cube, RoutingReg *reg)
+{
+    unsigned long n_ties = count_ties(cube, reg);
+    unsigned __int128 n_paths = multinomial_count(reg);
+
+    if ((n_paths == ULONG_MAX) || (n_ties >= 64))
+        return ULONG_MAX;
+
+    n_paths <<= n_ties;
+    return (n_paths >= ULONG_MAX) ? ULONG_MAX : n_paths;
+}
+
+/**
+ * @brief Write the indices of the vertices visited by the current path.
+ *
+ * @param it The iterator.
+ * @param indices Output array, with room for it->distance + 1 indices.
+ */
+void minimal_path_vertices(MinimalPathIter *it, unsigned long *indices)
+{
+    unsigned long pos, dim, stride, coord, index = it->source;
+    unsigned long k = it->cube->k;
+
+    indices[0] = index;
+    for (pos = 0; pos < it->distance; pos++)
+    {
+        // Coordinate 0 is the most significant digit of the index.
+        dim = it->moves[pos];
+        stride = 1;
+        for (unsigned long d = dim + 1; d < it->reg->length; d++)
+            stride *= k;
+        coord = (index / stride) % k;
+
+        if (it->reg->register_[dim] > 0)
+            index = index - coord * stride + ((coord + 1) % k) * stride;
+        else
+            index = index - coord * stride + ((coord + k - 1) % k) * stride;
+
+        indices[pos + 1] = index;
+    }
+}
+
+/**
+ * @brief Print the current path of the iterator.
+ *
+ * @param it The iterator.
+ */
+void print_minimal_path(MinimalPathIter *it)
+{
+    unsigned long pos;
+    unsigned long *indices = pooled_path_buffer(it->distance + 1);
+
+    minimal_path_vertices(it, indices);
+    printf("%ld", indices[0]);
+    for (pos = 1; pos <= it->distance; pos++)
+        printf(" -> %ld", indices[pos]);
+    printf("\n");
+
+    release_path_buffer(indices, it->distance + 1);
+}
+
+/**
+ * @brief xorshift64* pseudo-random generator.
+ *
+ * @param seed State of the generator (must not be 0). Updated.
+ * @return unsigned long A pseudo-random number.
+ */
+unsigned long path_rand(unsigned long *seed)
+{
+    *seed ^= *seed >> 12;
+    *seed ^= *seed << 25;
+    *seed ^= *seed >> 27;
+    return *seed * 0x2545F4914F6CDD1DUL;
+}
+
+/*! PATH DIVERSITY -- INIT !*/
+
+/**
+ * @brief Destination of a node under a permutation traffic pattern.
+ *
+ * @param cube A k-ary n-cube.
+ * @param pattern A traffic pattern (not UNIFORM_TRAFFIC).
+ * @param u_index The index of the source node.
+ * @return unsigned long The index of the destination node.
+ */
+unsigned long traffic_destination(k_ary_n_cube *cube, TrafficPattern pattern, unsigned long u_index)
+{
+    long coord, dim, k = cube->k, n_dims = cube->n;
+    unsigned long v_index = 0;
+
+    for (dim = 0; dim < n_dims; dim++)
+    {
+        switch (pattern)
+        {
+        case COMPLEMENT_TRAFFIC:
+            coord = k - 1 - vertex_coordinate(cube, u_index, dim);
+            break;
+        case TRANSPOSE_TRAFFIC:
+            coord = vertex_coordinate(cube, u_index, n_dims - 1 - dim);
+            break;
+        case TORNADO_TRAFFIC:
+            coord = (vertex_coordinate(cube, u_index, dim) + (k + 1) / 2 - 1) % k;
+            break;
+        default:
+            fprintf(stderr, "Traffic pattern %d is not a permutation.\n", pattern);
+            exit(errno);
+        }
+        v_index = v_index * k + coord;
+    }
+
+    return v_index;
+}
+
+/* Work split between path diversity threads */
+struct DiversityWork
+{
+    k_ary_n_cube *cube;
+    TrafficPattern pattern;
+    unsigned long begin, end; // Range of pair ranks of the thread.
+    PathDiversity stats;      // Means are kept as sums until merged.
+    RouteHistograms hists;    // Owned by the thread, merged on join.
+} typedef DiversityWork;
+
+/**
+ * @brief Worker thread: accumulate the statistics of a range of pairs.
+ *
+ * @param arg A DiversityWork structure.
+ * @return void* NULL.
+ */
+static void *path_diversity_worker(void *arg)
+{
+    DiversityWork *work = (DiversityWork *)arg;
+    k_ary_n_cube *cube = work->cube;
+    PathDiversity *stats = &work->stats;
+    unsigned long pair, u_index, v_index, n_paths, hops, dim;
+    unsigned long n_vertex = cube->n_vertex;
+    RoutingReg *reg = pooled_routing_reg(cube->n);
+    struct timespec start, stop;
+
+    for (pair = work->begin; pair < work->end; pair++)
+    {
+        if (work->pattern == UNIFORM_TRAFFIC)
+        {
+            u_index = pair / n_vertex;
+            v_index = pair % n_vertex;
+        }
+        else
+        {
+            u_index = pair;
+            v_index = traffic_destination(cube, work->pattern, u_index);
+        }
+        if (u_index == v_index)
+            continue;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        routing_reg_from(cube, u_index, v_index, reg);
+        n_paths = minimal_path_count(cube, reg);
+        clock_gettime(CLOCK_MONOTONIC, &stop);
+
+        hops = 0;
+        for (dim = 0; dim < reg->length; dim++)
+            hops += labs(reg->register_[dim]);
+
+        histogram_record(&work->hists.hops, hops);
+        histogram_record(&work->hists.route_ns, (stop.tv_sec - start.tv_sec) * 1000000000L + (stop.tv_nsec - start.tv_nsec));
+
+        stats->n_pairs++;
+        stats->single_path_pairs += (n_paths == 1);
+        stats->min_paths = (n_paths < stats->min_paths) ? n_paths : stats->min_paths;
+        stats->max_paths = (n_paths > stats->max_paths) ? n_paths : stats->max_paths;
+        stats->mean_paths += n_paths;
+        stats->mean_log2_paths += log2l(n_paths);
+        stats->mean_hops += hops;
+        stats->max_hops = (hops > stats->max_hops) ? hops : stats->max_hops;
+    }
+
+    release_routing_reg(reg);
+    return NULL;
+}
+
+/**
+ * @brief Work out the path diversity statistics of a traffic pattern.
+ *
+ * @param cube A k-ary n-cube.
+ * @param pattern The traffic pattern.
+ * @param n_threads Number of worker threads (<= 0: one per online CPU).
+ * @param stats The statistics to be filled in.
+ * @param hists Histograms the ones of the threads are merged into (may be NULL).
+ */
+void path_diversity(k_ary_n_cube *cube, TrafficPattern pattern, int n_threads, PathDiversity *stats, RouteHistograms *hists)
+{
+    unsigned long n_total, chunk, thread;
+    unsigned long n_vertex = cube->n_vertex;
+    DiversityWork *work;
+    pthread_t *threads;
+
+    // Uniform traffic goes over every pair: the number of pairs must be a long.
+    n_total = n_vertex;
+    if ((pattern == UNIFORM_TRAFFIC) && __builtin_mul_overflow(n_vertex, n_vertex, &n_total))
+    {
+        fprintf(stderr, "Too many pairs for uniform traffic: %lu vertices.\n", n_vertex);
+        exit(EOVERFLOW);
+    }
+
+    if (n_threads <= 0)
+        n_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n_threads <= 0)
+        n_threads = 1;
+    if (n_threads > n_total)
+        n_threads = n_total;
+    if (n_threads == 0)
+    {
+        fprintf(stderr, "No pairs to work out the path diversity of.\n");
+        exit(EINVAL);
+    }
+
+    work = (DiversityWork *)calloc(n_threads, sizeof(DiversityWork));
+    threads = (pthread_t *)malloc(n_threads * sizeof(pthread_t));
+
+    // Split the pairs in contiguous chunks, one per thread.
+    chunk = (n_total + n_threads - 1) / n_threads;
+    for (thread = 0; thread < n_threads; thread++)
+    {
+        work[thread].cube = cube;
+        work[thread].pattern = pattern;
+        work[thread].begin = thread * chunk;
+        work[thread].end = ((thread + 1) * chunk < n_total) ? (thread + 1) * chunk : n_total;
+        work[thread].stats.min_paths = ULONG_MAX;
+        define_route_histograms(&work[thread].hists);
+
+        if (pthread_create(&threads[thread], NULL, &path_diversity_worker, &work[thread]) != 0)
+        {
+            fprintf(stderr, "Could not create path diversity thread.\n");
+            exit(errno);
+        }
+    }
+
+    // Merge the partial statistics.
+    stats->n_pairs = 0;
+    stats->single_path_pairs = 0;
+    stats->min_paths = ULONG_MAX;
+    stats->max_paths = 0;
+    stats->mean_paths = 0;
+    stats->mean_log2_paths = 0;
+    stats->mean_hops = 0;
+    stats->max_hops = 0;
+    for (thread = 0; thread < n_threads; thread++)
+    {
+        PathDiversity *partial = &work[thread].stats;
+
+        pthread_join(threads[thread], NULL);
+        if (hists != NULL)
+            merge_route_histograms(hists, &work[thread].hists);
+        stats->n_pairs += partial->n_pairs;
+        stats->single_path_pairs += partial->single_path_pairs;
+        stats->min_paths = (partial->min_paths < stats->min_paths) ? partial->min_paths : stats->min_paths;
+        stats->max_paths = (partial->max_paths > stats->max_paths) ? partial->max_paths : stats->max_paths;
+        stats->mean_paths += partial->mean_paths;
+        stats->mean_log2_paths += partial->mean_log2_paths;
+        stats->mean_hops += partial->mean_hops;
+        stats->max_hops = (partial->max_hops > stats->max_hops) ? partial->max_hops : stats->max_hops;
+    }
+
+    if (stats->n_pairs > 0)
+    {
+        stats->mean_paths /= stats->n_pairs;
+        stats->mean_log2_paths /= stats->n_pairs;
+        stats->mean_hops /= stats->n_pairs;
+    }
+    else
+    {
+        stats->min_paths = 0;
+    }
+
+    free(threads);
+    free(work);
+}
+
+/**
+ * @brief Print path diversity statistics.
+ *
+ * @param stats The statistics to be printed.
+ */
+void print_path_diversity(PathDiversity *stats)
+{
+    printf(" ** Path Diversity ** \n");
+    printf(" \t Pairs: %lu (%lu with a single minimal path)\n", stats->n_pairs, stats->single_path_pairs);
+    printf(" \t Minimal paths per pair: min ");
+    print_path_count(stats->min_paths);
+    printf(", max ");
+    print_path_count(stats->max_paths);
+    printf(", mean %.2Lf (mean log2 %.2Lf)\n", stats->mean_paths, stats->mean_log2_paths);
+    printf(" \t Hops per pair: mean %.2Lf, max %lu\n", stats->mean_hops, stats->max_hops);
+}
+
+/**
+ * @brief Print a number of minimal paths, as returned by minimal_path_count.
+ *
+ * @param n_paths The number of paths (ULONG_MAX if it overflowed).
+ */
+void print_path_count(unsigned long n_paths)
+{
+    if (n_paths == ULONG_MAX)
+        printf("overflow (>= %lu)", ULONG_MAX);
+    else
+        printf("%lu", n_paths);
+}
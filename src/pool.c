@@ -0,0 +1,322 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+extern int errno;
+
+#include "../include/pool.h"
+
+/* Maximum number of size classes per thread */
+#define N_THREAD_POOLS 32
+
+static __thread Pool thread_pools[N_THREAD_POOLS];
+static __thread unsigned long n_thread_pools = 0;
+
+static pthread_key_t thread_pools_key;
+static pthread_once_t thread_pools_once = PTHREAD_ONCE_INIT;
+
+/*! POOL STRUCTURE -- INIT !*/
+
+/**
+ * @brief Define a pool of fixed-size objects.
+ *
+ * @param p The pool to be defined.
+ * @param obj_size The size in bytes of each object.
+ * @param slab_length The number of objects allocated at once (0: fit in POOL_SLAB_BYTES).
+ */
+void define_pool(Pool *p, unsigned long obj_size, unsigned long slab_length)
+{
+    if (obj_size <= 0)
+    {
+        fprintf(stderr, "Invalid pool object size.\n");
+        exit(errno);
+    }
+
+    // Every object must hold the free list link, and be aligned.
+    p->obj_size = (obj_size + POOL_ALIGN - 1) / POOL_ALIGN * POOL_ALIGN;
+    if (slab_length <= 0)
+    {
+        slab_length = POOL_SLAB_BYTES / p->obj_size;
+        if (slab_length < 8)
+            slab_length = 8;
+    }
+    p->slab_length = slab_length;
+
+    p->slabs = NULL;
+    p->free_list = NULL;
+    p->n_slabs = 0;
+    p->n_in_use = 0;
+}
+
+/**
+ * @brief Free every slab of the pool, keeping the structure.
+ *
+ * @param p The pool.
+ */
+static void clear_pool(Pool *p)
+{
+    void *slab, *next;
+
+    for (slab = p->slabs; slab != NULL; slab = next)
+    {
+        next = *(void **)slab;
+        free(slab);
+    }
+    p->slabs = NULL;
+    p->free_list = NULL;
+    p->n_slabs = 0;
+    p->n_in_use = 0;
+}
+
+/**
+ * @brief Free the pool structure, and every slab of it.
+ *
+ * @param p A pointer to the pool to be freed.
+ */
+void free_pool(Pool **p)
+{
+    clear_pool(*p);
+    free(*p);
+}
+
+/**
+ * @brief Thread every object of a slab into the free list.
+ *
+ * @param p The pool.
+ * @param slab The slab.
+ */
+static void thread_slab(Pool *p, void *slab)
+{
+    char *obj = (char *)slab + POOL_ALIGN; // Skip the slab link.
+
+    for (unsigned long index = 0; index < p->slab_length; index++, obj += p->obj_size)
+    {
+        *(void **)obj = p->free_list;
+        p->free_list = obj;
+    }
+}
+
+/**
+ * @brief Take an object from the pool.
+ *
+ * @param p The pool.
+ * @return void* An object of p->obj_size bytes (not initialised).
+ */
+void *pool_alloc(Pool *p)
+{
+    void *obj, *slab;
+
+    if (p->free_list == NULL)
+    {
+        // Every object is in use: grow by one slab.
+        slab = malloc(POOL_ALIGN + p->slab_length * p->obj_size);
+        if (slab == NULL)
+        {
+            fprintf(stderr, "Out of memory on pool allocation.\n");
+            exit(errno);
+        }
+
+        *(void **)slab = p->slabs;
+        p->slabs = slab;
+        p->n_slabs++;
+        thread_slab(p, slab);
+    }
+
+    obj = p->free_list;
+    p->free_list = *(void **)obj;
+    p->n_in_use++;
+    return obj;
+}
+
+/**
+ * @brief Give an object back to the pool.
+ *
+ * @param p The pool it was taken from.
+ * @param obj The object.
+ */
+void pool_release(Pool *p, void *obj)
+{
+    *(void **)obj = p->free_list;
+    p->free_list = obj;
+    p->n_in_use--;
+}
+
+/**
+ * @brief Give every object back to the pool at once.
+ *
+ * @param p The pool.
+ */
+void pool_release_all(Pool *p)
+{
+    void *slab;
+
+    p->free_list = NULL;
+    for (slab = p->slabs; slab != NULL; slab = *(void **)slab)
+    {
+        thread_slab(p, slab);
+    }
+    p->n_in_use = 0;
+}
+
+/*! THREAD-LOCAL POOLS -- INIT !*/
+
+/**
+ * @brief Thread exit destructor: free the pools of the thread.
+ *
+ * @param arg Unused.
+ */
+static void thread_pools_destructor(void *arg)
+{
+    free_thread_pools();
+}
+
+/**
+ * @brief Create the key used to free the pools on thread exit.
+ */
+static void thread_pools_init()
+{
+    pthread_key_create(&thread_pools_key, &thread_pools_destructor);
+}
+
+/**
+ * @brief Thread-local pool for objects of a given size.
+ *
+ * @param obj_size The size in bytes of each object.
+ * @return Pool* The pool of the calling thread.
+ */
+Pool *thread_pool(unsigned long obj_size)
+{
+    unsigned long index;
+    unsigned long rounded = (obj_size + POOL_ALIGN - 1) / POOL_ALIGN * POOL_ALIGN;
+
+    for (index = 0; index < n_thread_pools; index++)
+    {
+        if (thread_pools[index].obj_size == rounded)
+            return &thread_pools[index];
+    }
+
+    if (n_thread_pools == N_THREAD_POOLS)
+    {
+        fprintf(stderr, "Too many pool size classes in one thread.\n");
+        exit(errno);
+    }
+
+    // First pool of the thread: register it to be freed on exit.
+    if (n_thread_pools == 0)
+    {
+        pthread_once(&thread_pools_once, &thread_pools_init);
+        pthread_setspecific(thread_pools_key, thread_pools);
+    }
+
+    define_pool(&thread_pools[n_thread_pools], rounded, 0);
+    return &thread_pools[n_thread_pools++];
+}
+
+/**
+ * @brief Free every thread-local pool of the calling thread.
+ */
+void free_thread_pools()
+{
+    for (unsigned long index = 0; index < n_thread_pools; index++)
+    {
+        clear_pool(&thread_pools[index]);
+    }
+    n_thread_pools = 0;
+}
+
+/*! POOLED STRUCTURES -- INIT !*/
+
+/**
+ * @brief Take a vertex with room for n_dims coordinates from the
+ * thread-local pools.
+ *
+ * @param index The index of the vertex.
+ * @param n_dims The number of dimensions of the coordinates.
+ * @return Vertex* The vertex (coordinates not initialised).
+ */
+Vertex *pooled_vertex(unsigned long index, unsigned long n_dims)
+{
+    // The coordinates are stored right after the structure.
+    Vertex *v = (Vertex *)pool_alloc(thread_pool(sizeof(Vertex) + n_dims * sizeof(long)));
+
+    v->index = index;
+    v->n_dims = n_dims;
+    v->coordinates = (long *)(v + 1);
+    return v;
+}
+
+/**
+ * @brief Give a pooled vertex back to the thread-local pools.
+ *
+ * @param v The vertex.
+ */
+void release_vertex(Vertex *v)
+{
+    pool_release(thread_pool(sizeof(Vertex) + v->n_dims * sizeof(long)), v);
+}
+
+/**
+ * @brief Take a routing register from the thread-local pools.
+ *
+ * @param length The length of the register.
+ * @return RoutingReg* The register (set to 0).
+ */
+RoutingReg *pooled_routing_reg(unsigned long length)
+{
+    // The register values are stored right after the structure.
+    RoutingReg *reg = (RoutingReg *)pool_alloc(thread_pool(sizeof(RoutingReg) + length * sizeof(long)));
+
+    reg->length = length;
+    reg->register_ = (long *)(reg + 1);
+    memset(reg->register_, 0, length * sizeof(long));
+    return reg;
+}
+
+/**
+ * @brief Give a pooled routing register back to the thread-local pools.
+ *
+ * @param reg The register.
+ */
+void release_routing_reg(RoutingReg *reg)
+{
+    pool_release(thread_pool(sizeof(RoutingReg) + reg->length * sizeof(long)), reg);
+}
+
+/**
+ * @brief Size in bytes of the path buffer class of a length.
+ *
+ * @param length The number of entries.
+ * @return unsigned long The size of the class.
+ */
+static unsigned long path_buffer_size(unsigned long length)
+{
+    unsigned long rounded = 1;
+
+    while (rounded < length)
+        rounded <<= 1;
+    return rounded * sizeof(unsigned long);
+}
+
+/**
+ * @brief Take a path buffer from the thread-local pools.
+ *
+ * @param length The number of entries.
+ * @return unsigned long* The buffer (not initialised).
+ */
+unsigned long *pooled_path_buffer(unsigned long length)
+{
+    return (unsigned long *)pool_alloc(thread_pool(path_buffer_size(length)));
+}
+
+/**
+ * @brief Give a pooled path buffer back to the thread-local pools.
+ *
+ * @param buffer The buffer.
+ * @param length The number of entries it was taken with.
+ */
+void release_path_buffer(unsigned long *buffer, unsigned long length)
+{
+    pool_release(thread_pool(path_buffer_size(length)), buffer);
+}
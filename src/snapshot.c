@@ -0,0 +1,486 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+extern int errno;
+
+#include "../include/snapshot.h"
+
+/* Size of the buffer used to stream the snapshot out */
+#define SNAPSHOT_BUFFER 65536
+
+/* Room for ".tmp.<pid>.<sequence>" and the terminator */
+#define SNAPSHOT_TMP_SUFFIX 48
+
+#define FNV_OFFSET 0xcbf29ce484222325UL
+#define FNV_PRIME 0x100000001b3UL
+
+/* Output stream of the snapshot writer (plain syscalls, no stdio:
+ * it also runs in a forked child of a multithreaded process). */
+struct SnapshotWriter
+{
+    int fd;
+    uint64_t checksum;
+    unsigned long used;
+    bool failed;
+    unsigned char buffer[SNAPSHOT_BUFFER];
+} typedef SnapshotWriter;
+
+/**
+ * @brief Update a FNV-1a checksum with a block of bytes.
+ *
+ * @param checksum The checksum so far.
+ * @param data The bytes.
+ * @param size The number of bytes.
+ * @return uint64_t The new checksum.
+ */
+static uint64_t fnv1a(uint64_t checksum, const unsigned char *data, unsigned long size)
+{
+    for (unsigned long index = 0; index < size; index++)
+    {
+        checksum ^= data[index];
+        checksum *= FNV_PRIME;
+    }
+    return checksum;
+}
+
+/**
+ * @brief Write all the bytes of a block, retrying on short writes.
+ *
+ * @param fd The file descriptor.
+ * @param data The bytes.
+ * @param size The number of bytes.
+ * @return bool 1 on success.
+ */
+static bool write_all(int fd, const unsigned char *data, unsigned long size)
+{
+    ssize_t written;
+
+    while (size > 0)
+    {
+        written = write(fd, data, size);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return 0;
+        }
+        data += written;
+        size -= written;
+    }
+    return 1;
+}
+
+/**
+ * @brief Flush the buffer of the writer.
+ *
+ * @param w The writer.
+ */
+static void flush_writer(SnapshotWriter *w)
+{
+    if (!w->failed && !write_all(w->fd, w->buffer, w->used))
+        w->failed = 1;
+    w->used = 0;
+}
+
+/**
+ * @brief Append bytes to the payload of the snapshot.
+ *
+ * @param w The writer.
+ * @param data The bytes.
+ * @param size The number of bytes.
+ */
+static void put_bytes(SnapshotWriter *w, const void *data, unsigned long size)
+{
+    const unsigned char *bytes = (const unsigned char *)data;
+    unsigned long chunk;
+
+    w->checksum = fnv1a(w->checksum, bytes, size);
+    while (size > 0)
+    {
+        if (w->used == SNAPSHOT_BUFFER)
+            flush_writer(w);
+        chunk = SNAPSHOT_BUFFER - w->used;
+        chunk = (chunk < size) ? chunk : size;
+        memcpy(w->buffer + w->used, bytes, chunk);
+        w->used += chunk;
+        bytes += chunk;
+        size -= chunk;
+    }
+}
+
+/**
+ * @brief Write a whole snapshot file. Only uses syscalls, so it is safe
+ * in a forked child.
+ *
+ * @param cube The k-ary n-cube.
+ * @param user Caller state to be saved along.
+ * @param user_size The size in bytes of the caller state.
+ * @param path The path of the snapshot file.
+ * @param tmp_path The path the file is written to before the rename.
+ * @return bool 1 on success.
+ */
+static bool write_snapshot(k_ary_n_cube *cube, const void *user, unsigned long user_size,
+                           const char *path, const char *tmp_path)
+{
+    SnapshotHeader header;
+    SnapshotWriter *w;
+    unsigned long vertex_index, dim;
+    int64_t value;
+    uint64_t n_dims = cube->n, n_vertex = cube->n_vertex;
+    uint64_t n_table = (cube->g != NULL) ? n_vertex : 0; // Hypercubes have no coordinate table.
+    bool ok;
+
+    memset(&header, 0, sizeof(SnapshotHeader));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version = SNAPSHOT_VERSION;
+    header.header_size = sizeof(SnapshotHeader);
+    header.n = cube->n;
+    header.k = cube->k;
+    header.has_rings = cube->has_rings;
+    header.n_vertex = n_vertex;
+    header.coords_offset = sizeof(SnapshotHeader);
+    header.reg_offset = header.coords_offset + n_table * n_dims * sizeof(int64_t);
+    header.user_offset = header.reg_offset + n_dims * sizeof(int64_t);
+    header.user_size = user_size;
+    header.file_size = header.user_offset + user_size;
+
+    // The writer holds the I/O buffer: keep it off the stack.
+    w = (SnapshotWriter *)mmap(NULL, sizeof(SnapshotWriter), PROT_READ | PROT_WRITE,
+                               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (w == MAP_FAILED)
+        return 0;
+
+    w->fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    w->checksum = FNV_OFFSET;
+    w->used = 0;
+    w->failed = (w->fd < 0);
+
+    // Leave room for the header: it holds the checksum of the rest.
+    if (!w->failed && lseek(w->fd, sizeof(SnapshotHeader), SEEK_SET) < 0)
+        w->failed = 1;
+
+    for (vertex_index = 0; vertex_index < n_table; vertex_index++)
+    {
+        for (dim = 0; dim < n_dims; dim++)
+        {
+            value = cube->g->vertices[vertex_index]->coordinates[dim];
+            put_bytes(w, &value, sizeof(int64_t));
+        }
+    }
+    for (dim = 0; dim < n_dims; dim++)
+    {
+        value = cube->last_reg->register_[dim];
+        put_bytes(w, &value, sizeof(int64_t));
+    }
+    if (user_size > 0)
+        put_bytes(w, user, user_size);
+    flush_writer(w);
+
+    header.checksum = w->checksum;
+    if (!w->failed && pwrite(w->fd, &header, sizeof(SnapshotHeader), 0) != sizeof(SnapshotHeader))
+        w->failed = 1;
+    if (!w->failed && fsync(w->fd) < 0)
+        w->failed = 1;
+    if (w->fd >= 0)
+        close(w->fd);
+
+    ok = !w->failed && (rename(tmp_path, path) == 0);
+    if (!ok)
+        unlink(tmp_path);
+
+    munmap(w, sizeof(SnapshotWriter));
+    return ok;
+}
+
+/**
+ * @brief Path of the temporary file a snapshot is written to. It is
+ * unique per writer (pid and sequence number of the call), so writers
+ * running at the same time never share a temporary file.
+ *
+ * @param path The path of the snapshot file.
+ * @return char* A new string (to be freed).
+ */
+static char *snapshot_tmp_path(const char *path)
+{
+    static unsigned long n_writers = 0; // Updated atomically.
+    unsigned long sequence = __atomic_fetch_add(&n_writers, 1, __ATOMIC_RELAXED);
+    unsigned long size = strlen(path) + SNAPSHOT_TMP_SUFFIX;
+    char *tmp_path = (char *)malloc(size);
+
+    snprintf(tmp_path, size, "%s.tmp.%ld.%lu", path, (long)getpid(), sequence);
+    return tmp_path;
+}
+
+/**
+ * @brief Check the layout described by a snapshot header against the size
+ * of the file. Every size is worked out with overflow checks, so a crafted
+ * header can neither wrap an offset around nor ask for a huge allocation.
+ *
+ * @param header The header of the snapshot.
+ * @param file_size The size in bytes of the file.
+ * @return bool 1 if the layout is valid.
+ */
+static bool check_snapshot_layout(const SnapshotHeader *header, uint64_t file_size)
+{
+    uint64_t n_vertex = 1, n_table, table_size, reg_size, offset;
+    bool hypercube = (header->k == 2) && !header->has_rings;
+
+    if ((header->n <= 0) || (header->k < 2) || (header->has_rings > 1))
+        return 0;
+    if (hypercube && (header->n > HYPERCUBE_MAX_DIMS))
+        return 0;
+
+    // The cube must have exactly k^n vertices.
+    for (int64_t dim = 0; dim < header->n; dim++)
+    {
+        if (__builtin_mul_overflow(n_vertex, (uint64_t)header->k, &n_vertex))
+            return 0;
+    }
+    if (header->n_vertex != n_vertex)
+        return 0;
+
+    // The coordinate table is indexed with int (see encode_coordinates).
+    n_table = hypercube ? 0 : n_vertex;
+    if (n_table > INT_MAX)
+        return 0;
+
+    if (__builtin_mul_overflow(n_table, (uint64_t)header->n, &table_size) ||
+        __builtin_mul_overflow(table_size, sizeof(int64_t), &table_size) ||
+        __builtin_mul_overflow((uint64_t)header->n, sizeof(int64_t), &reg_size))
+        return 0;
+
+    offset = sizeof(SnapshotHeader);
+    if (header->coords_offset != offset)
+        return 0;
+    if (__builtin_add_overflow(offset, table_size, &offset) || (header->reg_offset != offset))
+        return 0;
+    if (__builtin_add_overflow(offset, reg_size, &offset) || (header->user_offset != offset))
+        return 0;
+    if (__builtin_add_overflow(offset, header->user_size, &offset) || (header->file_size != offset))
+        return 0;
+
+    return header->file_size == file_size;
+}
+
+/*! SNAPSHOT -- INIT !*/
+
+/**
+ * @brief Write a snapshot of the cube, plus caller state, into a file.
+ *
+ * @param cube The k-ary n-cube.
+ * @param user Caller state to be saved along.
+ * @param user_size The size in bytes of the caller state.
+ * @param path The path of the snapshot file.
+ */
+void save_snapshot(k_ary_n_cube *cube, const void *user, unsigned long user_size, const char *path)
+{
+    char *tmp_path = snapshot_tmp_path(path);
+
+    bool written = write_snapshot(cube, user, user_size, path, tmp_path);
+
+    free(tmp_path);
+    if (!written)
+    {
+        fprintf(stderr, "Could not write snapshot %s.\n", path);
+        exit((errno != 0) ? errno : EIO);
+    }
+}
+
+/**
+ * @brief Write a snapshot in the background (copy-on-write child).
+ *
+ * @param cube The k-ary n-cube.
+ * @param user Caller state to be saved along.
+ * @param user_size The size in bytes of the caller state.
+ * @param path The path of the snapshot file.
+ * @return pid_t The writer process, to be passed to wait_snapshot.
+ */
+pid_t save_snapshot_async(k_ary_n_cube *cube, const void *user, unsigned long user_size, const char *path)
+{
+    pid_t writer;
+    char *tmp_path = snapshot_tmp_path(path);
+
+    // Flush stdio first, or the child would print pending output again.
+    fflush(stdout);
+    fflush(stderr);
+
+    writer = fork();
+    if (writer < 0)
+    {
+        fprintf(stderr, "Could not fork the snapshot writer.\n");
+        exit(errno);
+    }
+    if (writer == 0)
+    {
+        _exit(write_snapshot(cube, user, user_size, path, tmp_path) ? 0 : 1);
+    }
+
+    free(tmp_path);
+    return writer;
+}
+
+/**
+ * @brief Wait for a background snapshot to be written.
+ *
+ * @param writer The writer process returned by save_snapshot_async.
+ * @return bool 1 if the snapshot was written, 0 otherwise.
+ */
+bool wait_snapshot(pid_t writer)
+{
+    int status;
+
+    while (waitpid(writer, &status, 0) < 0)
+    {
+        if (errno != EINTR)
+            return 0;
+    }
+    return WIFEXITED(status) && (WEXITSTATUS(status) == 0);
+}
+
+/**
+ * @brief Map a snapshot file into memory.
+ *
+ * @param path The path of the snapshot file.
+ * @param size Where the size in bytes of the file is stored.
+ * @return unsigned char* The mapping, or NULL if the file could not be mapped.
+ */
+static unsigned char *map_snapshot(const char *path, unsigned long *size)
+{
+    int fd;
+    struct stat st;
+    unsigned char *data;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        fprintf(stderr, "Could not open snapshot %s.\n", path);
+        return NULL;
+    }
+    if ((fstat(fd, &st) < 0) || (st.st_size < sizeof(SnapshotHeader)))
+    {
+        fprintf(stderr, "Snapshot %s is truncated.\n", path);
+        close(fd);
+        return NULL;
+    }
+
+    data = (unsigned char *)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        fprintf(stderr, "Could not map snapshot %s.\n", path);
+        return NULL;
+    }
+
+    *size = st.st_size;
+    return data;
+}
+
+/**
+ * @brief Check a mapped snapshot: header, layout, checksum and the size
+ * of the caller state.
+ *
+ * @param data The mapping of the file.
+ * @param size The size in bytes of the file.
+ * @param user_size The size in bytes of the caller state.
+ * @param path The path of the snapshot file (for the messages).
+ * @return bool 1 if the snapshot can be restored.
+ */
+static bool check_snapshot(const unsigned char *data, unsigned long size, unsigned long user_size, const char *path)
+{
+    const SnapshotHeader *header = (const SnapshotHeader *)data;
+
+    if ((memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) ||
+        (header->version != SNAPSHOT_VERSION) ||
+        (header->header_size != sizeof(SnapshotHeader)))
+    {
+        fprintf(stderr, "%s is not a valid snapshot.\n", path);
+        return 0;
+    }
+    if (!check_snapshot_layout(header, size) ||
+        (fnv1a(FNV_OFFSET, data + sizeof(SnapshotHeader), size - sizeof(SnapshotHeader)) != header->checksum))
+    {
+        fprintf(stderr, "Snapshot %s is corrupted.\n", path);
+        return 0;
+    }
+    if (header->user_size != user_size)
+    {
+        fprintf(stderr, "Snapshot %s holds %lu bytes of state, %lu expected.\n",
+                path, (unsigned long)header->user_size, user_size);
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Restore a cube and the caller state from a snapshot file.
+ *
+ * @param cube The k-ary n-cube to be defined (not defined yet).
+ * @param user Where the caller state is restored.
+ * @param user_size The size in bytes of the caller state; must match the file.
+ * @param path The path of the snapshot file.
+ * @return bool 1 if the snapshot was restored, 0 otherwise (nothing is touched).
+ */
+bool load_snapshot(k_ary_n_cube *cube, void *user, unsigned long user_size, const char *path)
+{
+    unsigned char *data;
+    unsigned long size, vertex_index, dim, n_table;
+    const SnapshotHeader *header;
+    const int64_t *coords, *reg;
+
+    // Check the whole file before touching the cube or the caller state.
+    data = map_snapshot(path, &size);
+    if (data == NULL)
+        return 0;
+    if (!check_snapshot(data, size, user_size, path))
+    {
+        munmap(data, size);
+        return 0;
+    }
+    header = (const SnapshotHeader *)data;
+
+    /* Allocate memory for the structure */
+    n_table = ((header->k == 2) && !header->has_rings) ? 0 : header->n_vertex;
+    cube->n = header->n;
+    cube->k = header->k;
+    cube->has_rings = header->has_rings;
+    cube->n_vertex = header->n_vertex;
+    cube->g = NULL;
+    if (n_table > 0)
+    {
+        cube->g = (PartialGraph *)malloc(sizeof(PartialGraph));
+        define_graph(cube->g, n_table, header->n);
+    }
+
+    /* Allocate memory for the register */
+    cube->last_reg = (RoutingReg *)malloc(sizeof(RoutingReg));
+    define_routing_reg(cube->last_reg, header->n);
+
+    // Copy the coordinates and the register out of the mapping.
+    coords = (const int64_t *)(data + header->coords_offset);
+    for (vertex_index = 0; vertex_index < n_table; vertex_index++)
+    {
+        for (dim = 0; dim < header->n; dim++)
+        {
+            cube->g->vertices[vertex_index]->coordinates[dim] = coords[vertex_index * header->n + dim];
+        }
+    }
+    reg = (const int64_t *)(data + header->reg_offset);
+    for (dim = 0; dim < header->n; dim++)
+    {
+        cube->last_reg->register_[dim] = reg[dim];
+    }
+    if (user_size > 0)
+        memcpy(user, data + header->user_offset, user_size);
+
+    select_routing_function(cube);
+    munmap(data, size);
+    return 1;
+}
@@ -6,6 +6,9 @@
 extern int errno;
 
 #include "../include/topologies.h"
+#include "../include/paths.h"
+#include "../include/pool.h"
+#include "../include/hypercube.h"
 
 /*! K-ARY N-CUBE STRUCTURE -- INIT !*/
 
@@ -56,55 +59,182 @@ void define_kary_ncube(k_ary_n_cube *cube)
     /* Allocate memory for the structure */
     cube->n = n_dims;
     cube->k = k;
-    cube->g = (PartialGraph *)malloc(sizeof(PartialGraph));
-    define_graph(cube->g, n_vertex, n_dims);
+    cube->has_rings = has_rings;
 
     /* Allocate memory for the register */
     cube->last_reg = (RoutingReg *)malloc(sizeof(RoutingReg));
     define_routing_reg(cube->last_reg, n_dims);
 
+    if (is_hypercube(cube))
+    {
+        // A hypercube node is its index: no coordinate table is needed.
+        if (n_dims > HYPERCUBE_MAX_DIMS)
+        {
+            fprintf(stderr, "Error dims: hypercubes of up to %d dimensions are supported.\n", HYPERCUBE_MAX_DIMS);
+            exit(errno);
+        }
+        n_vertex = 1L << n_dims;
+        cube->g = NULL;
+    }
+    else
+    {
+        cube->g = (PartialGraph *)malloc(sizeof(PartialGraph));
+        define_graph(cube->g, n_vertex, n_dims);
+    }
+    cube->n_vertex = n_vertex;
+
     // Encode the coordinates of the k-ary n-cube.
-    encode_coordinates(cube);
+    if (cube->g != NULL)
+        encode_coordinates(cube);
+
+    // Define the *routing function*.
+    printf("%ld-ary %ld-%s", k, n_dims, select_routing_function(cube));
+    printf(": %ld nodes in total\n", n_vertex);
+}
+
+/**
+ * @brief Whether a k-ary n-cube is a hypercube (k == 2 and no rings).
+ *
+ * @param cube A k-ary n-cube, with k and has_rings defined.
+ * @return bool 1 if it is a hypercube.
+ */
+bool is_hypercube(k_ary_n_cube *cube)
+{
+    return (cube->k == 2) && !cube->has_rings;
+}
+
+/**
+ * @brief Coordinate of a vertex in one dimension.
+ *
+ * @param cube A k-ary n-cube.
+ * @param index The index of the vertex.
+ * @param dim The dimension (0 is the most significant digit of the index).
+ * @return long The coordinate.
+ */
+long vertex_coordinate(k_ary_n_cube *cube, unsigned long index, unsigned long dim)
+{
+    // Hypercubes have no coordinate table: read the bit of the index.
+    if (cube->g == NULL)
+        return (index >> (cube->n - 1 - dim)) & 1;
+
+    return cube->g->vertices[index]->coordinates[dim];
+}
+
+/**
+ * @brief Print the index and coordinates of a vertex of the cube.
+ *
+ *  FORMAT: %index% [ coord., sep. by spaces ]
+ *
+ * @param cube A k-ary n-cube.
+ * @param index The index of the vertex.
+ */
+void print_cube_vertex(k_ary_n_cube *cube, unsigned long index)
+{
+    if (cube->g != NULL)
+    {
+        print_vertex(cube->g, index);
+        return;
+    }
+
+    printf("%ld [ ", index);
+    for (long dim = 0; dim < cube->n; dim++)
+        printf("%ld ", vertex_coordinate(cube, index, dim));
+    printf("]");
+}
+
+/**
+ * @brief Check the indices of a routing: both must be vertices of the cube.
+ *
+ * @param cube A k-ary n-cube.
+ * @param u_index The index of the source node.
+ * @param v_index The index of the destination node.
+ */
+static void check_routing_indices(k_ary_n_cube *cube, long u_index, long v_index)
+{
+    if ((u_index < 0) || (v_index < 0) || (u_index >= cube->n_vertex) || (v_index >= cube->n_vertex))
+    {
+        fprintf(stderr, "Invalid index on routing.\n");
+        exit(errno);
+    }
+}
 
+/**
+ * @brief Set the routing function of a k-ary n-cube from its features.
+ *
+ * @param cube A k-ary n-cube, with n, k and has_rings defined.
+ * @return const char* The name of the topology.
+ */
+const char *select_routing_function(k_ary_n_cube *cube)
+{
     // Decide whether it's a hypercube (k == 2 and no rings)
     // a torus (k >= 2 and has rings) or a mesh (k >= 2 and no rings).
-    // Define the edges to be set and the *routing function*.
-    printf("%ld-ary %ld-", k, n_dims);
-    if ((k == 2) && !has_rings)
+    if (is_hypercube(cube))
     {
-        printf("hypercube");
         cube->routing_function = &hypercube_routing_func;
+        return "hypercube";
     }
-    else if (k >= 2)
+    else if (cube->has_rings)
     {
-        if (has_rings)
-        {
-            printf("torus");
-            cube->routing_function = &torus_routing_func;
-        }
-        else
-        {
-            printf("mesh");
-            cube->routing_function = &mesh_routing_func;
-        }
+        cube->routing_function = &torus_routing_func;
+        return "torus";
+    }
+    else
+    {
+        cube->routing_function = &mesh_routing_func;
+        return "mesh";
     }
-    printf(": %ld nodes in total\n", n_vertex);
 }
 
 /**
- * @brief Routing from one vertex, to another.
+ * @brief Print a step of a hypercube path: its index and coordinates.
  *
- * @param cube A K-ary N-cube.
+ * @param cube A n-hypercube.
+ * @param index The index of the node reached.
+ * @param step The number of the step.
+ */
+static void print_hypercube_step(k_ary_n_cube *cube, uint64_t index, unsigned int step)
+{
+    printf("( INDEX = %ld ) Step %d taken = [ ", (unsigned long)index, step);
+    for (long i = cube->n - 1; i >= 0; i--)
+        printf("%ld ", (long)((index >> i) & 1));
+    printf("]\n");
+}
+
+/**
+ * @brief Walk a hypercube path in e-cube order (lowest bit, i.e. last
+ * coordinate, first), printing every step. Same path as the generic walk,
+ * and like it, consumes cube->last_reg: every dimension crossed is set to 0.
+ *
+ * @param cube A n-hypercube.
  * @param u_index The index of the source node.
  * @param v_index The index of the destination node.
  */
-void routing_from(k_ary_n_cube *cube, int u_index, int v_index)
+static void hypercube_walk(k_ary_n_cube *cube, uint64_t u_index, uint64_t v_index)
 {
-    if (u_index * v_index <= 0)
+    unsigned int n_steps_taken = 0;
+    long dim;
+
+    printf(" ** PATH TAKEN (from the begining to the end) ** \n\n");
+    print_hypercube_step(cube, u_index, n_steps_taken++);
+    while ((dim = hypercube_next_dim(u_index, v_index)) >= 0)
     {
-        fprintf(stderr, "Invalid index on routing.\n");
-        exit(errno);
+        // Bit dim of the index is coordinate n - 1 - dim.
+        cube->last_reg->register_[cube->n - 1 - dim] = 0;
+        u_index ^= 1UL << dim;
+        print_hypercube_step(cube, u_index, n_steps_taken++);
     }
+}
+
+/**
+ * @brief Routing from one vertex, to another.
+ *
+ * @param cube A K-ary N-cube.
+ * @param u_index The index of the source node.
+ * @param v_index The index of the destination node.
+ */
+void routing_from(k_ary_n_cube *cube, long u_index, long v_index)
+{
+    check_routing_indices(cube, u_index, v_index);
 
     long coord_value, coord_index;
     unsigned long distance, reg_length = cube->last_reg->length;
@@ -114,9 +244,9 @@ void routing_from(k_ary_n_cube *cube, int u_index, int v_index)
 
     // Represent which vertices are going to be source and destination.
     printf("The package goes from ");
-    print_vertex(cube->g, u_index);
+    print_cube_vertex(cube, u_index);
     printf(" to ");
-    print_vertex(cube->g, v_index);
+    print_cube_vertex(cube, v_index);
     printf(".\n\n");
 
     // Work out the routing register to go from one point to the other.
@@ -133,11 +263,22 @@ void routing_from(k_ary_n_cube *cube, int u_index, int v_index)
         printf("%ld ", coord_value);
     }
     printf("] <-- \n");
-    printf("Graph distance between nodes: %ld\n\n", distance);
+    printf("Graph distance between nodes: %ld\n", distance);
+    printf("Number of minimal paths: ");
+    print_path_count(minimal_path_count(cube, cube->last_reg));
+    printf("\n\n");
+
+    // Hypercubes: a node is its index, so walk the path with bit operations.
+    if (cube->routing_function == &hypercube_routing_func)
+    {
+        hypercube_walk(cube, u_index, v_index);
+        return;
+    }
 
     // Clone origin vertex: later, we will modify the coordinates of the vertex.
-    u_clone = (Vertex *)malloc(sizeof(Vertex));
-    define_vertex(u_clone, 0, reg_length);
+    // The clone is taken from the thread pools, so repeated routings do not
+    // touch the heap.
+    u_clone = pooled_vertex(0, reg_length);
     clone_vertex(cube->g->vertices[u_index], u_clone);
 
     // Visualise the origin.
@@ -181,8 +322,8 @@ void routing_from(k_ary_n_cube *cube, int u_index, int v_index)
         }
     }
 
-    // Lastly, free the auxiliary vertex u_clone.
-    free_vertex(&u_clone);
+    // Lastly, give the auxiliary vertex u_clone back to the pool.
+    release_vertex(u_clone);
 }
 
 /**
@@ -192,7 +333,8 @@ void routing_from(k_ary_n_cube *cube, int u_index, int v_index)
  */
 void free_kary_ncube(k_ary_n_cube **cube)
 {
-    free_graph(&((*cube)->g));              // Firstly, free the subjacent graph.
+    if ((*cube)->g != NULL)
+        free_graph(&((*cube)->g));          // Firstly, free the subjacent graph (none for hypercubes).
     free_routing_reg(&((*cube)->last_reg)); // Free last routing register structure.
     free(*cube);                            // Then, free the k-ary n-cube.
 }
@@ -228,30 +370,23 @@ void free_routing_reg(RoutingReg **reg)
     free(*reg);
 }
 
+/*! ROUTING REGISTER COMPUTATION -- INIT !*/
+
 /**
- * @brief Routing function for n-dimensional mesh, with k-nodes per dim.
+ * @brief Work out the mesh routing register between two vertices.
  *
  * @param cube A k-ary n-cube
- * @param u A vertex in the cube
- * @param v Another vertex in the cube
+ * @param u_index The index of the source node.
+ * @param v_index The index of the destination node.
+ * @param reg The register to be filled in.
  */
-void mesh_routing_func(k_ary_n_cube *cube, int u_index, int v_index)
+static void mesh_routing_reg(k_ary_n_cube *cube, unsigned long u_index, unsigned long v_index, RoutingReg *reg)
 {
-    if (u_index * v_index <= 0)
-    {
-        fprintf(stderr, "Invalid index on routing.\n");
-        exit(errno);
-    }
-    
     // Take the vertices from the graph.
     Vertex *u, *v;
     u = cube->g->vertices[u_index];
     v = cube->g->vertices[v_index];
 
-    // Routing register
-    RoutingReg *reg;
-    reg = cube->last_reg; // Se supone inicializado
-
     // Work out the steps to take in all dims of the mesh.
     for (int coordinate_index = 0; coordinate_index < u->n_dims; coordinate_index++)
     {
@@ -260,38 +395,29 @@ void mesh_routing_func(k_ary_n_cube *cube, int u_index, int v_index)
 }
 
 /**
- * @brief Routing function for n-dimensional torus, with k-nodes per dim.
+ * @brief Work out the torus routing register between two vertices.
  *
  * @param cube A k-ary n-cube
- * @param u A vertex in the cube
- * @param v Another vertex in the cube
+ * @param u_index The index of the source node.
+ * @param v_index The index of the destination node.
+ * @param reg The register to be filled in.
  */
-void torus_routing_func(k_ary_n_cube *cube, int u_index, int v_index)
+static void torus_routing_reg(k_ary_n_cube *cube, unsigned long u_index, unsigned long v_index, RoutingReg *reg)
 {
     long reg_val;
 
-    if (u_index * v_index <= 0)
-    {
-        fprintf(stderr, "Invalid index on routing.\n");
-        exit(errno);
-    }
-
     // Take the vertices from the graph.
     Vertex *u, *v;
     u = cube->g->vertices[u_index];
     v = cube->g->vertices[v_index];
 
-    // Routing register
-    RoutingReg *reg;
-    reg = cube->last_reg; // Se supone inicializado
-
-    // Work out the steps to take in all dims of the mesh.
+    // Work out the steps to take in all dims of the torus.
     for (int coordinate_index = 0; coordinate_index < u->n_dims; coordinate_index++)
     {
         reg_val = v->coordinates[coordinate_index] - u->coordinates[coordinate_index];
 
         // Correct the path if it is very long.
-        if (abs(reg_val) > (cube->k / 2))
+        if (labs(reg_val) > (cube->k / 2))
         {
             if (reg_val > 0)
             {
@@ -308,35 +434,96 @@ void torus_routing_func(k_ary_n_cube *cube, int u_index, int v_index)
 }
 
 /**
- * @brief Routing function for n-dimensional hypercube.
+ * @brief Work out the hypercube routing register between two vertices.
  *
  * @param cube A n-hypercube.
- * @param u A vertex in the cube
- * @param v Another vertex in the cube
+ * @param u_index The index of the source node.
+ * @param v_index The index of the destination node.
+ * @param reg The register to be filled in.
  */
-void hypercube_routing_func(k_ary_n_cube *cube, int u_index, int v_index)
+static void hypercube_routing_reg(k_ary_n_cube *cube, unsigned long u_index, unsigned long v_index, RoutingReg *reg)
 {
-    if (u_index * v_index <= 0)
+    // A node is its index: one XOR gives every dimension to be crossed.
+    // Coordinate c is bit n - 1 - c of the index.
+    uint64_t route = hypercube_route(u_index, v_index);
+
+    for (long coordinate_index = 0; coordinate_index < cube->n; coordinate_index++)
+    {
+        reg->register_[coordinate_index] = (route >> (cube->n - 1 - coordinate_index)) & 1;
+    }
+}
+
+/**
+ * @brief Work out the routing register from one vertex to another,
+ * without touching the last register of the cube.
+ *
+ * @param cube A k-ary n-cube.
+ * @param u_index The index of the source node.
+ * @param v_index The index of the destination node.
+ * @param reg The register to be filled in (length n).
+ */
+void routing_reg_from(k_ary_n_cube *cube, unsigned long u_index, unsigned long v_index, RoutingReg *reg)
+{
+    if ((u_index >= cube->n_vertex) || (v_index >= cube->n_vertex))
     {
         fprintf(stderr, "Invalid index on routing.\n");
         exit(errno);
     }
 
-    // Take the vertices from the graph.
-    Vertex *u, *v;
-    u = cube->g->vertices[u_index];
-    v = cube->g->vertices[v_index];
-
-    // Routing register
-    RoutingReg *reg;
-    reg = cube->last_reg; // Se supone inicializado
-
-    // Work out the steps to take in all dims of the mesh.
-    for (int coordinate_index = 0; coordinate_index < u->n_dims; coordinate_index++)
+    if (is_hypercube(cube))
     {
-        // In hex, 0 = 0b00000000 and 1 = 0b00000001. So, use bitwise XOR.
-        reg->register_[coordinate_index] = (v->coordinates[coordinate_index]) ^ (u->coordinates[coordinate_index]);
+        hypercube_routing_reg(cube, u_index, v_index, reg);
     }
+    else if (cube->has_rings)
+    {
+        torus_routing_reg(cube, u_index, v_index, reg);
+    }
+    else
+    {
+        mesh_routing_reg(cube, u_index, v_index, reg);
+    }
+}
+
+/**
+ * @brief Routing function for n-dimensional mesh, with k-nodes per dim.
+ *
+ * @param cube A k-ary n-cube
+ * @param u A vertex in the cube
+ * @param v Another vertex in the cube
+ */
+void mesh_routing_func(k_ary_n_cube *cube, long u_index, long v_index)
+{
+    check_routing_indices(cube, u_index, v_index);
+
+    mesh_routing_reg(cube, u_index, v_index, cube->last_reg);
+}
+
+/**
+ * @brief Routing function for n-dimensional torus, with k-nodes per dim.
+ *
+ * @param cube A k-ary n-cube
+ * @param u A vertex in the cube
+ * @param v Another vertex in the cube
+ */
+void torus_routing_func(k_ary_n_cube *cube, long u_index, long v_index)
+{
+    check_routing_indices(cube, u_index, v_index);
+
+    torus_routing_reg(cube, u_index, v_index, cube->last_reg);
+}
+
+/**
+ * @brief Routing function for n-dimensional hypercube.
+ *
+ * @param cube A n-hypercube.
+ * @param u A vertex in the cube
+ * @param v Another vertex in the cube
+ */
+void hypercube_routing_func(k_ary_n_cube *cube, long u_index, long v_index)
+{
+    check_routing_indices(cube, u_index, v_index);
+
+    hypercube_routing_reg(cube, u_index, v_index, cube->last_reg);
 }
 
 /**
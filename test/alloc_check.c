@@ -0,0 +1,113 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/topologies.h"
+#include "../include/paths.h"
+#include "../include/pool.h"
+
+/* Cubes to be checked: n, k, has rings */
+static const char *configs[] = {"3 4 0", "3 4 1", "2 6 1", "6 2 0"};
+
+/*! ALLOCATION COUNTER -- INIT !*/
+
+/* The check is linked with -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc
+ * (see the Makefile): every call from the program's own code lands here
+ * before reaching the C library. Allocations made inside the C library
+ * itself are not counted. */
+static __thread unsigned long n_heap_allocations = 0;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n_members, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size)
+{
+    n_heap_allocations++;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t n_members, size_t size)
+{
+    n_heap_allocations++;
+    return __real_calloc(n_members, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    n_heap_allocations++;
+    return __real_realloc(ptr, size);
+}
+
+/*! ROUTING LOOP -- INIT !*/
+
+/**
+ * @brief Route every pair of a cube: routing_from, routing_reg_from and
+ * a minimal path iterator. The calling thread's allocations are counted.
+ *
+ * @param cube A k-ary n-cube.
+ * @param it An iterator defined on the cube, reused for every seek.
+ * @param seed State of the random generator.
+ */
+static void routing_loop(k_ary_n_cube *cube, MinimalPathIter *it, unsigned long *seed)
+{
+    unsigned long u_index, v_index, n_vertex = cube->n_vertex;
+    RoutingReg *reg = pooled_routing_reg(cube->n);
+
+    for (u_index = 0; u_index < n_vertex; u_index++)
+    {
+        for (v_index = 0; v_index < n_vertex; v_index++)
+        {
+            routing_from(cube, u_index, v_index);
+            routing_reg_from(cube, u_index, v_index, reg);
+            minimal_path_count(cube, reg);
+        }
+
+        seek_minimal_path(it, u_index % minimal_path_count(cube, it->reg), 2);
+        while (next_minimal_path(it))
+            ;
+        sample_minimal_path(it, seed);
+    }
+
+    release_routing_reg(reg);
+}
+
+int main()
+{
+    k_ary_n_cube *cube;
+    MinimalPathIter *it;
+    unsigned long before, after, seed = 42;
+    int failed = 0;
+
+    // The routing functions print every step: keep them quiet.
+    if (freopen("/dev/null", "w", stdout) == NULL)
+        return 1;
+
+    for (int index = 0; index < sizeof(configs) / sizeof(configs[0]); index++)
+    {
+        // define_kary_ncube reads the cube features from stdin.
+        stdin = fmemopen((void *)configs[index], strlen(configs[index]), "r");
+        cube = (k_ary_n_cube *)malloc(sizeof(k_ary_n_cube));
+        define_kary_ncube(cube);
+        fclose(stdin);
+
+        it = (MinimalPathIter *)malloc(sizeof(MinimalPathIter));
+        define_path_iter(it, cube, 0, cube->n_vertex - 1);
+
+        // Warm up the pools, then check the loop does not touch the heap.
+        routing_loop(cube, it, &seed);
+        before = n_heap_allocations;
+        routing_loop(cube, it, &seed);
+        after = n_heap_allocations;
+
+        fprintf(stderr, "%s: %lu heap allocations after warm-up (%s)\n",
+                configs[index], after - before, (after == before) ? "OK" : "FAILED");
+        failed |= (after != before);
+
+        free_path_iter(&it);
+        free_kary_ncube(&cube);
+    }
+
+    free_thread_pools();
+    return failed;
+}
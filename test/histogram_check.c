@@ -0,0 +1,158 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../include/histogram.h"
+#include "../include/paths.h"
+
+/* Number of values recorded */
+#define N_VALUES 200000
+
+/* Number of histograms the values are split between for merging */
+#define N_PARTS 4
+
+/* Percentiles checked against the exact ones */
+static const double percentiles[] = {0, 1, 10, 25, 50, 75, 90, 99, 99.9, 99.99, 100};
+
+/**
+ * @brief qsort comparison of two values.
+ */
+static int compare_values(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Check the percentiles of a histogram against the exact ones:
+ * the relative error must be within the documented 2^(1-PRECISION).
+ *
+ * @param h The histogram the values were recorded into.
+ * @param sorted The values, sorted.
+ * @return double The worst relative error seen (-1 if one is out of bounds).
+ */
+static double check_percentiles(Histogram *h, const uint64_t *sorted)
+{
+    double bound = 2.0 / (1UL << HISTOGRAM_PRECISION), error, worst = 0;
+    uint64_t rank, exact, value;
+
+    for (int index = 0; index < sizeof(percentiles) / sizeof(percentiles[0]); index++)
+    {
+        // Same rank as histogram_percentile (1-based, nearest).
+        rank = (uint64_t)(percentiles[index] / 100.0 * N_VALUES + 0.5);
+        rank = (rank < 1) ? 1 : ((rank > N_VALUES) ? N_VALUES : rank);
+        exact = sorted[rank - 1];
+        value = histogram_percentile(h, percentiles[index]);
+
+        // The percentile is the highest value of its bucket: never below.
+        if (value < exact)
+            return -1;
+        error = (exact > 0) ? (double)(value - exact) / exact : (double)value;
+        if (error >= bound)
+            return -1;
+        worst = (error > worst) ? error : worst;
+    }
+    return worst;
+}
+
+/**
+ * @brief Whether two histograms hold the same counts and statistics.
+ *
+ * @param a A histogram.
+ * @param b Another histogram.
+ * @return bool 1 if they are equal.
+ */
+static bool same_histogram(Histogram *a, Histogram *b)
+{
+    return memcmp(a, b, sizeof(Histogram)) == 0;
+}
+
+/**
+ * @brief Report the result of a check.
+ *
+ * @param name The name of the check.
+ * @param ok Whether it passed.
+ * @return int 1 if it failed.
+ */
+static int report(const char *name, bool ok)
+{
+    fprintf(stderr, "%s (%s)\n", name, ok ? "OK" : "FAILED");
+    return !ok;
+}
+
+int main()
+{
+    uint64_t *values = (uint64_t *)malloc(N_VALUES * sizeof(uint64_t));
+    Histogram *whole = (Histogram *)malloc(sizeof(Histogram));
+    Histogram *merged = (Histogram *)malloc(sizeof(Histogram));
+    Histogram *imported = (Histogram *)malloc(sizeof(Histogram));
+    Histogram *parts = (Histogram *)malloc(N_PARTS * sizeof(Histogram));
+    char dir[] = "/tmp/histogram_check.XXXXXX", path[sizeof(dir) + 16], paths[N_PARTS][sizeof(dir) + 16];
+    unsigned long seed = 42;
+    double worst;
+    int failed = 0;
+
+    if (mkdtemp(dir) == NULL)
+        return 1;
+
+    // Values of every magnitude, from exact buckets up to 2^63.
+    define_histogram(whole);
+    for (int part = 0; part < N_PARTS; part++)
+        define_histogram(&parts[part]);
+    for (unsigned long index = 0; index < N_VALUES; index++)
+    {
+        values[index] = path_rand(&seed) >> (path_rand(&seed) % 64);
+        histogram_record(whole, values[index]);
+        histogram_record(&parts[index % N_PARTS], values[index]);
+    }
+    qsort(values, N_VALUES, sizeof(uint64_t), &compare_values);
+
+    worst = check_percentiles(whole, values);
+    fprintf(stderr, "percentiles: worst relative error %.3f%%\n", 100 * worst);
+    failed |= report("percentiles within the precision bound", worst >= 0);
+    failed |= report("min and max are exact", (whole->min == values[0]) && (whole->max == values[N_VALUES - 1]));
+
+    // Merging the parts must give the histogram of every value.
+    define_histogram(merged);
+    for (int part = 0; part < N_PARTS; part++)
+        histogram_merge(merged, &parts[part]);
+    failed |= report("merged parts equal the whole", same_histogram(merged, whole));
+
+    // Export and import: a single file, then the files of every part.
+    snprintf(path, sizeof(path), "%s/whole.hist", dir);
+    histogram_export(whole, path);
+    define_histogram(imported);
+    histogram_import(imported, path);
+    failed |= report("export and import round-trip", same_histogram(imported, whole));
+
+    define_histogram(imported);
+    for (int part = 0; part < N_PARTS; part++)
+    {
+        snprintf(paths[part], sizeof(paths[part]), "%s/part%d.hist", dir, part);
+        histogram_export(&parts[part], paths[part]);
+        histogram_import(imported, paths[part]);
+    }
+    failed |= report("imported parts equal the whole", same_histogram(imported, whole));
+
+    // Empty histograms round-trip too.
+    define_histogram(merged);
+    histogram_export(merged, path);
+    define_histogram(imported);
+    histogram_import(imported, path);
+    failed |= report("empty histogram round-trip", same_histogram(imported, merged) &&
+                                                       (histogram_percentile(imported, 50) == 0));
+
+    unlink(path);
+    for (int part = 0; part < N_PARTS; part++)
+        unlink(paths[part]);
+    rmdir(dir);
+
+    free(values);
+    free_histogram(&whole);
+    free_histogram(&merged);
+    free_histogram(&imported);
+    free(parts);
+    return failed;
+}
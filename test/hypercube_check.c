@@ -0,0 +1,135 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/topologies.h"
+#include "../include/paths.h"
+#include "../include/hypercube.h"
+#include "../include/pool.h"
+
+/* Number of random pairs given to the batch functions */
+#define N_PAIRS 100000
+
+/* Hypercube checked against the generic routing register: n, k, has rings */
+static const char *config = "6 2 0";
+
+/**
+ * @brief Compare the batch functions with the inline helpers, pair by pair.
+ * The pairs are random, plus equal nodes and nodes one bit apart.
+ *
+ * @return bool 1 on success.
+ */
+static bool check_batches()
+{
+    uint64_t *u = (uint64_t *)malloc(N_PAIRS * sizeof(uint64_t));
+    uint64_t *v = (uint64_t *)malloc(N_PAIRS * sizeof(uint64_t));
+    uint64_t *routes = (uint64_t *)malloc(N_PAIRS * sizeof(uint64_t));
+    uint64_t *next = (uint64_t *)malloc(N_PAIRS * sizeof(uint64_t));
+    unsigned char *distances = (unsigned char *)malloc(N_PAIRS * sizeof(unsigned char));
+    unsigned long pair, seed = 42;
+    bool ok = 1;
+
+    for (pair = 0; pair < N_PAIRS; pair++)
+    {
+        u[pair] = path_rand(&seed);
+        switch (pair % 4)
+        {
+        case 0:
+            v[pair] = u[pair];
+            break;
+        case 1:
+            v[pair] = u[pair] ^ (1UL << (pair % 64));
+            break;
+        default:
+            v[pair] = path_rand(&seed);
+        }
+    }
+
+    hypercube_route_batch(u, v, routes, N_PAIRS);
+    hypercube_distance_batch(u, v, distances, N_PAIRS);
+    hypercube_next_hop_batch(u, v, next, N_PAIRS);
+    for (pair = 0; ok && (pair < N_PAIRS); pair++)
+    {
+        ok = (routes[pair] == hypercube_route(u[pair], v[pair])) &&
+             (distances[pair] == hypercube_distance(u[pair], v[pair])) &&
+             (next[pair] == hypercube_next_hop(u[pair], v[pair])) &&
+             ((u[pair] == v[pair]) ? (hypercube_next_dim(u[pair], v[pair]) == -1)
+                                   : (next[pair] == (u[pair] ^ (1UL << hypercube_next_dim(u[pair], v[pair])))));
+    }
+
+    free(u);
+    free(v);
+    free(routes);
+    free(next);
+    free(distances);
+    return ok;
+}
+
+/**
+ * @brief Compare the inline helpers with the routing register of every
+ * pair of a hypercube, and check e-cube walks reach the destination in
+ * as many hops as the distance.
+ *
+ * @param cube A n-hypercube.
+ * @return bool 1 on success.
+ */
+static bool check_cube(k_ary_n_cube *cube)
+{
+    RoutingReg *reg = pooled_routing_reg(cube->n);
+    unsigned long u_index, v_index, hops, distance;
+    uint64_t node;
+    bool ok = 1;
+
+    for (u_index = 0; ok && (u_index < cube->n_vertex); u_index++)
+    {
+        for (v_index = 0; ok && (v_index < cube->n_vertex); v_index++)
+        {
+            routing_reg_from(cube, u_index, v_index, reg);
+            distance = 0;
+            for (long dim = 0; dim < cube->n; dim++)
+            {
+                // Bit n - 1 - dim of the packed register is coordinate dim.
+                ok = ok && ((labs(reg->register_[dim]) != 0) ==
+                            ((hypercube_route(u_index, v_index) >> (cube->n - 1 - dim)) & 1));
+                distance += labs(reg->register_[dim]);
+            }
+            ok = ok && (distance == hypercube_distance(u_index, v_index));
+
+            for (node = u_index, hops = 0; (node != v_index) && (hops <= cube->n); hops++)
+                node = hypercube_next_hop(node, v_index);
+            ok = ok && (hops == distance);
+        }
+    }
+
+    release_routing_reg(reg);
+    return ok;
+}
+
+int main()
+{
+    k_ary_n_cube *cube;
+    bool ok;
+    int failed = 0;
+
+    // define_kary_ncube prints the cube features: keep it quiet.
+    if (freopen("/dev/null", "w", stdout) == NULL)
+        return 1;
+
+    ok = check_batches();
+    fprintf(stderr, "batches against inline helpers: %d pairs (%s)\n", N_PAIRS, ok ? "OK" : "FAILED");
+    failed |= !ok;
+
+    // define_kary_ncube reads the cube features from stdin.
+    stdin = fmemopen((void *)config, strlen(config), "r");
+    cube = (k_ary_n_cube *)malloc(sizeof(k_ary_n_cube));
+    define_kary_ncube(cube);
+    fclose(stdin);
+
+    ok = check_cube(cube);
+    fprintf(stderr, "%s: inline helpers against routing registers (%s)\n", config, ok ? "OK" : "FAILED");
+    failed |= !ok;
+
+    free_kary_ncube(&cube);
+    free_thread_pools();
+    return failed;
+}
@@ -0,0 +1,219 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/topologies.h"
+#include "../include/paths.h"
+#include "../include/pool.h"
+
+/* Cubes to be checked: n, k, has rings (meshes, even and odd tori, hypercube) */
+static const char *configs[] = {"2 4 0", "3 3 0", "3 4 1", "2 6 1", "3 3 1", "2 5 1", "3 2 1", "4 2 0"};
+
+/**
+ * @brief Neighbour of a vertex one step along a dimension.
+ *
+ * @param cube A k-ary n-cube.
+ * @param index The index of the vertex.
+ * @param dim The dimension.
+ * @param step +1 or -1.
+ * @return long The index of the neighbour, or -1 if there is none (mesh border).
+ */
+static long neighbour(k_ary_n_cube *cube, unsigned long index, long dim, long step)
+{
+    long coord = vertex_coordinate(cube, index, dim) + step, weight = 1;
+
+    if ((coord < 0) || (coord >= cube->k))
+    {
+        if (!cube->has_rings)
+            return -1;
+        coord = (coord + cube->k) % cube->k;
+    }
+    for (long d = cube->n - 1; d > dim; d--)
+        weight *= cube->k;
+    return index + (coord - vertex_coordinate(cube, index, dim)) * weight;
+}
+
+/**
+ * @brief Breadth-first search from a vertex: distance and number of
+ * shortest paths to every vertex.
+ *
+ * @param cube A k-ary n-cube.
+ * @param source The index of the source node.
+ * @param distance Output, one entry per vertex.
+ * @param n_paths Output, one entry per vertex.
+ */
+static void bfs_path_counts(k_ary_n_cube *cube, unsigned long source, long *distance, unsigned long *n_paths)
+{
+    unsigned long *queue = (unsigned long *)malloc(cube->n_vertex * sizeof(unsigned long));
+    unsigned long head = 0, tail = 0, u_index;
+    long v_index, other;
+
+    for (long index = 0; index < cube->n_vertex; index++)
+    {
+        distance[index] = -1;
+        n_paths[index] = 0;
+    }
+    distance[source] = 0;
+    n_paths[source] = 1;
+    queue[tail++] = source;
+
+    while (head < tail)
+    {
+        u_index = queue[head++];
+        for (long dim = 0; dim < cube->n; dim++)
+        {
+            for (long step = -1; step <= 1; step += 2)
+            {
+                v_index = neighbour(cube, u_index, dim, step);
+                other = neighbour(cube, u_index, dim, -step);
+                // On a 2-ary torus both steps reach the same node: one link.
+                if ((v_index < 0) || ((step > 0) && (v_index == other)))
+                    continue;
+                if (distance[v_index] < 0)
+                {
+                    distance[v_index] = distance[u_index] + 1;
+                    queue[tail++] = v_index;
+                }
+                if (distance[v_index] == distance[u_index] + 1)
+                    n_paths[v_index] += n_paths[u_index];
+            }
+        }
+    }
+    free(queue);
+}
+
+/**
+ * @brief Whether two vertices are linked.
+ *
+ * @param cube A k-ary n-cube.
+ * @param u_index The index of a vertex.
+ * @param v_index The index of another vertex.
+ * @return bool 1 if they are neighbours.
+ */
+static bool adjacent(k_ary_n_cube *cube, unsigned long u_index, unsigned long v_index)
+{
+    for (long dim = 0; dim < cube->n; dim++)
+    {
+        if ((neighbour(cube, u_index, dim, 1) == v_index) || (neighbour(cube, u_index, dim, -1) == v_index))
+            return 1;
+    }
+    return 0;
+}
+
+/* Length of the paths being sorted by compare_paths */
+static unsigned long path_length;
+
+/**
+ * @brief qsort comparison of two paths (arrays of path_length indices).
+ */
+static int compare_paths(const void *a, const void *b)
+{
+    return memcmp(a, b, path_length * sizeof(unsigned long));
+}
+
+/**
+ * @brief Check the minimal paths between two vertices: the count matches
+ * the BFS count, every path is minimal, adjacent step to step, ends at the
+ * destination and is visited once, and seeking reaches the same paths.
+ *
+ * @param cube A k-ary n-cube.
+ * @param u_index The index of the source node.
+ * @param v_index The index of the destination node.
+ * @param distance The BFS distance from the source to the destination.
+ * @param bfs_paths The BFS number of shortest paths.
+ * @return bool 1 on success.
+ */
+static bool check_pair(k_ary_n_cube *cube, unsigned long u_index, unsigned long v_index,
+                       long distance, unsigned long bfs_paths)
+{
+    MinimalPathIter *it = (MinimalPathIter *)malloc(sizeof(MinimalPathIter));
+    unsigned long n_paths, rank, hop, length = distance + 1;
+    unsigned long *paths, *seeked = (unsigned long *)malloc(length * sizeof(unsigned long));
+    bool ok;
+
+    define_path_iter(it, cube, u_index, v_index);
+    n_paths = minimal_path_count(cube, it->reg);
+    ok = (n_paths == bfs_paths) && (it->distance == distance);
+
+    // Enumerate every path.
+    paths = (unsigned long *)malloc(n_paths * length * sizeof(unsigned long));
+    for (rank = 0; ok && next_minimal_path(it); rank++)
+    {
+        if (rank == n_paths)
+        {
+            ok = 0;
+            break;
+        }
+        minimal_path_vertices(it, paths + rank * length);
+        ok = (paths[rank * length] == u_index) && (paths[rank * length + distance] == v_index);
+        for (hop = 0; ok && (hop < distance); hop++)
+            ok = adjacent(cube, paths[rank * length + hop], paths[rank * length + hop + 1]);
+    }
+    ok = ok && (rank == n_paths);
+
+    // The r-th path of the enumeration is the one seek reaches.
+    for (rank = 0; ok && (rank < n_paths); rank++)
+    {
+        seek_minimal_path(it, rank, 1);
+        ok = next_minimal_path(it);
+        minimal_path_vertices(it, seeked);
+        ok = ok && (memcmp(seeked, paths + rank * length, length * sizeof(unsigned long)) == 0) &&
+             !next_minimal_path(it);
+    }
+
+    // Every path is visited once.
+    if (ok)
+    {
+        path_length = length;
+        qsort(paths, n_paths, length * sizeof(unsigned long), &compare_paths);
+        for (rank = 1; ok && (rank < n_paths); rank++)
+            ok = (compare_paths(paths + (rank - 1) * length, paths + rank * length) != 0);
+    }
+
+    free(paths);
+    free(seeked);
+    free_path_iter(&it);
+    return ok;
+}
+
+int main()
+{
+    k_ary_n_cube *cube;
+    long *distance;
+    unsigned long *n_paths, n_failed;
+    int failed = 0;
+
+    // define_kary_ncube prints the cube features: keep it quiet.
+    if (freopen("/dev/null", "w", stdout) == NULL)
+        return 1;
+
+    for (int index = 0; index < sizeof(configs) / sizeof(configs[0]); index++)
+    {
+        // define_kary_ncube reads the cube features from stdin.
+        stdin = fmemopen((void *)configs[index], strlen(configs[index]), "r");
+        cube = (k_ary_n_cube *)malloc(sizeof(k_ary_n_cube));
+        define_kary_ncube(cube);
+        fclose(stdin);
+
+        distance = (long *)malloc(cube->n_vertex * sizeof(long));
+        n_paths = (unsigned long *)malloc(cube->n_vertex * sizeof(unsigned long));
+        n_failed = 0;
+        for (unsigned long u_index = 0; u_index < cube->n_vertex; u_index++)
+        {
+            bfs_path_counts(cube, u_index, distance, n_paths);
+            for (unsigned long v_index = 0; v_index < cube->n_vertex; v_index++)
+                n_failed += !check_pair(cube, u_index, v_index, distance[v_index], n_paths[v_index]);
+        }
+
+        fprintf(stderr, "%s: %lu pairs with wrong minimal paths (%s)\n",
+                configs[index], n_failed, (n_failed == 0) ? "OK" : "FAILED");
+        failed |= (n_failed != 0);
+
+        free(distance);
+        free(n_paths);
+        free_kary_ncube(&cube);
+    }
+
+    free_thread_pools();
+    return failed;
+}
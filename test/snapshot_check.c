@@ -0,0 +1,210 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <unistd.h>
+
+#include "../include/topologies.h"
+#include "../include/paths.h"
+#include "../include/snapshot.h"
+#include "../include/pool.h"
+
+/* Cubes to be checked: n, k, has rings */
+static const char *configs[] = {"3 4 1", "6 2 0"};
+
+#define N_SAMPLES 64
+
+/* Caller state saved along with the cube */
+struct RunState
+{
+    unsigned long seed;    // Random generator of the run.
+    unsigned long n_steps; // Samples taken so far.
+    unsigned long source, target;
+} typedef RunState;
+
+/**
+ * @brief Take samples of minimal paths, as a run would, and keep a hash
+ * of the moves of each one.
+ *
+ * @param cube A k-ary n-cube.
+ * @param state The state of the run (updated).
+ * @param trace Where the sampled paths are summed up (N_SAMPLES entries).
+ */
+static void run_samples(k_ary_n_cube *cube, RunState *state, unsigned long *trace)
+{
+    MinimalPathIter *it = (MinimalPathIter *)malloc(sizeof(MinimalPathIter));
+
+    define_path_iter(it, cube, state->source, state->target);
+    for (int sample = 0; sample < N_SAMPLES; sample++, state->n_steps++)
+    {
+        sample_minimal_path(it, &state->seed);
+        trace[sample] = it->tie_mask;
+        for (unsigned long hop = 0; hop < it->distance; hop++)
+            trace[sample] = trace[sample] * 31 + it->moves[hop];
+    }
+    free_path_iter(&it);
+}
+
+/**
+ * @brief Compare a restored cube with the original one.
+ *
+ * @param cube The original cube.
+ * @param restored The cube restored from a snapshot.
+ * @return bool 1 if they hold the same state.
+ */
+static bool same_cube(k_ary_n_cube *cube, k_ary_n_cube *restored)
+{
+    if ((cube->n != restored->n) || (cube->k != restored->k) || (cube->has_rings != restored->has_rings) ||
+        (cube->n_vertex != restored->n_vertex) || (cube->routing_function != restored->routing_function) ||
+        ((cube->g == NULL) != (restored->g == NULL)))
+        return 0;
+
+    for (long dim = 0; dim < cube->n; dim++)
+    {
+        if (cube->last_reg->register_[dim] != restored->last_reg->register_[dim])
+            return 0;
+    }
+    for (long index = 0; (cube->g != NULL) && (index < cube->n_vertex); index++)
+    {
+        if (memcmp(cube->g->vertices[index]->coordinates, restored->g->vertices[index]->coordinates,
+                   cube->n * sizeof(long)) != 0)
+            return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Save a cube in the middle of a run, restore it, and check the
+ * restored run goes on exactly like the original one.
+ *
+ * @param cube A k-ary n-cube.
+ * @param path The path of the snapshot file.
+ * @param async Whether the snapshot is written in the background.
+ * @return bool 1 on success.
+ */
+static bool check_restore(k_ary_n_cube *cube, const char *path, bool async)
+{
+    RunState state = {42, 0, 1, cube->n_vertex - 2}, restored_state;
+    unsigned long trace[N_SAMPLES], restored_trace[N_SAMPLES];
+    k_ary_n_cube *restored;
+    bool ok;
+
+    // Leave something in the register, then save in the middle of the run.
+    cube->routing_function(cube, state.source, state.target);
+    run_samples(cube, &state, trace);
+    if (async)
+        ok = wait_snapshot(save_snapshot_async(cube, &state, sizeof(RunState), path));
+    else
+    {
+        save_snapshot(cube, &state, sizeof(RunState), path);
+        ok = 1;
+    }
+
+    restored = (k_ary_n_cube *)malloc(sizeof(k_ary_n_cube));
+    ok = ok && load_snapshot(restored, &restored_state, sizeof(RunState), path);
+    if (!ok)
+    {
+        free(restored);
+        return 0;
+    }
+    ok = same_cube(cube, restored) && (memcmp(&state, &restored_state, sizeof(RunState)) == 0);
+
+    // Both runs must go on bit-identically.
+    run_samples(cube, &state, trace);
+    run_samples(restored, &restored_state, restored_trace);
+    ok = ok && (memcmp(trace, restored_trace, sizeof(trace)) == 0) &&
+         (memcmp(&state, &restored_state, sizeof(RunState)) == 0);
+
+    free_kary_ncube(&restored);
+    return ok;
+}
+
+/**
+ * @brief Check a damaged snapshot is rejected and leaves the cube and the
+ * caller state untouched.
+ *
+ * @param cube A k-ary n-cube.
+ * @param path The path of the snapshot file.
+ * @param offset Where the file is damaged (from the end if negative).
+ * @param value The bytes written there.
+ * @param size The number of bytes written.
+ * @return bool 1 if the snapshot was rejected.
+ */
+static bool check_rejected(k_ary_n_cube *cube, const char *path, long offset, const void *value, unsigned long size)
+{
+    RunState state = {7, 0, 0, 0}, untouched_state;
+    k_ary_n_cube restored, untouched_cube;
+    FILE *file;
+
+    save_snapshot(cube, &state, sizeof(RunState), path);
+    file = fopen(path, "r+b");
+    if (file == NULL)
+        return 0;
+    if ((fseek(file, offset, (offset < 0) ? SEEK_END : SEEK_SET) != 0) || (fwrite(value, size, 1, file) != 1))
+    {
+        fclose(file);
+        return 0;
+    }
+    fclose(file);
+
+    memset(&untouched_cube, 0xab, sizeof(k_ary_n_cube));
+    memset(&untouched_state, 0xab, sizeof(RunState));
+    restored = untouched_cube;
+    state = untouched_state;
+    if (load_snapshot(&restored, &state, sizeof(RunState), path))
+        return 0;
+    return (memcmp(&restored, &untouched_cube, sizeof(k_ary_n_cube)) == 0) &&
+           (memcmp(&state, &untouched_state, sizeof(RunState)) == 0);
+}
+
+/**
+ * @brief Report the result of a check.
+ *
+ * @param config The cube features.
+ * @param name The name of the check.
+ * @param ok Whether it passed.
+ * @return int 1 if it failed.
+ */
+static int report(const char *config, const char *name, bool ok)
+{
+    fprintf(stderr, "%s: %s (%s)\n", config, name, ok ? "OK" : "FAILED");
+    return !ok;
+}
+
+int main()
+{
+    k_ary_n_cube *cube;
+    char dir[] = "/tmp/snapshot_check.XXXXXX", path[sizeof(dir) + 16];
+    unsigned char flipped = 0x5a;
+    uint64_t huge_n_vertex = UINT64_MAX / 2;
+    int failed = 0;
+
+    // define_kary_ncube prints the cube features: keep it quiet.
+    if ((freopen("/dev/null", "w", stdout) == NULL) || (mkdtemp(dir) == NULL))
+        return 1;
+    snprintf(path, sizeof(path), "%s/cube.snap", dir);
+
+    for (int index = 0; index < sizeof(configs) / sizeof(configs[0]); index++)
+    {
+        // define_kary_ncube reads the cube features from stdin.
+        stdin = fmemopen((void *)configs[index], strlen(configs[index]), "r");
+        cube = (k_ary_n_cube *)malloc(sizeof(k_ary_n_cube));
+        define_kary_ncube(cube);
+        fclose(stdin);
+
+        failed |= report(configs[index], "save and restore", check_restore(cube, path, 0));
+        failed |= report(configs[index], "background save and restore", check_restore(cube, path, 1));
+        failed |= report(configs[index], "corrupted payload rejected",
+                         check_rejected(cube, path, -1, &flipped, sizeof(flipped)));
+        failed |= report(configs[index], "oversized header rejected",
+                         check_rejected(cube, path, offsetof(SnapshotHeader, n_vertex),
+                                        &huge_n_vertex, sizeof(huge_n_vertex)));
+
+        free_kary_ncube(&cube);
+    }
+
+    unlink(path);
+    rmdir(dir);
+    free_thread_pools();
+    return failed;
+}